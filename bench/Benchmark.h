@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+    struct Result
+    {
+        std::string name;
+        int size = 0;           // samples along each side of the grid
+        int threads = 1;
+        std::size_t items = 0;  // items processed by one iteration, counted in unit
+        const char* unit = "vertex";
+        std::size_t bytes = 0;  // bytes written by one iteration
+        int iterations = 0;
+        double medianNs = 0.0;
+        double minNs = 0.0;
+
+        double nsPerItem() const { return medianNs / static_cast<double>(items); }
+        double megabytesPerSecond() const { return static_cast<double>(bytes) / (medianNs * 1e-9) / 1e6; }
+    };
+
+    // Runs fn once to warm up, then again until minSeconds are spent (at least three
+    // times). The median iteration is reported, so one slow outlier never moves it.
+    // items are vertices unless the caller sets another unit on the result.
+    template<typename Function>
+    Result measure(const std::string& name, int size, int threads, std::size_t items, std::size_t bytes, double minSeconds, Function&& fn)
+    {
+        using Clock = std::chrono::steady_clock;
+
+        fn();
+
+        std::vector<double> samples;
+        const auto start = Clock::now();
+        while (samples.size() < 3 || std::chrono::duration<double>(Clock::now() - start).count() < minSeconds)
+        {
+            const auto before = Clock::now();
+            fn();
+            samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - before).count());
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        Result result;
+        result.name = name;
+        result.size = size;
+        result.threads = threads;
+        result.items = items;
+        result.bytes = bytes;
+        result.iterations = static_cast<int>(samples.size());
+        result.medianNs = samples[samples.size() / 2];
+        result.minNs = samples.front();
+        return result;
+    }
+
+    // One progress line per result on stderr, so stdout stays pure JSON
+    inline void report(const Result& result)
+    {
+        std::fprintf(stderr, "%-20s size %5d threads %3d  %9.3f ns/%-11s  %9.1f MB/s  (%d runs)\n",
+            result.name.c_str(), result.size, result.threads, result.nsPerItem(), result.unit, result.megabytesPerSecond(), result.iterations);
+    }
+
+    inline void writeJson(std::FILE* out, const std::vector<Result>& results, const std::string& simd, unsigned hardwareThreads)
+    {
+        std::fprintf(out, "{\n  \"context\": {\"simd\": \"%s\", \"hardware_threads\": %u},\n  \"results\": [\n", simd.c_str(), hardwareThreads);
+
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& r = results[i];
+            std::fprintf(out,
+                "    {\"name\": \"%s\", \"size\": %d, \"threads\": %d, \"items\": %zu, \"unit\": \"%s\", \"iterations\": %d, "
+                "\"median_ns\": %.0f, \"min_ns\": %.0f, \"ns_per_item\": %.4f, \"mb_per_s\": %.2f}%s\n",
+                r.name.c_str(), r.size, r.threads, r.items, r.unit, r.iterations,
+                r.medianNs, r.minNs, r.nsPerItem(), r.megabytesPerSecond(), i + 1 < results.size() ? "," : "");
+        }
+
+        std::fprintf(out, "  ]\n}\n");
+    }
+
+}
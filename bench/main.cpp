@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/math/Noise.h"
+#include "utils/math/NoiseGraph.h"
+#include "utils/math/Point3dBatch.h"
+#include "utils/math/RuntimeNoise.h"
+#include "utils/math/Simd.h"
+#include "utils/threading/ThreadPool.h"
+
+#include "engine/terrain/ChunkGrid.h"
+#include "engine/terrain/HeightGenerator.h"
+#include "engine/terrain/HydraulicErosion.h"
+#include "engine/terrain/Kernels.h"
+#include "engine/terrain/Heightfield.h"
+#include "engine/terrain/LodQuadtree.h"
+#include "engine/terrain/NormalGenerator.h"
+#include "engine/terrain/TerrainVertex.h"
+#include "engine/terrain/ThermalErosion.h"
+
+#include "Benchmark.h"
+
+// Headless benchmarks of the CPU side of terrain building, the same calls Map::load
+// makes. Progress goes to stderr, JSON results to stdout or --output.
+//
+//   terrain-bench [--sizes 257,1025,2001] [--threads 1,4] [--min-time 0.5] [--output results.json]
+//
+// Any other argument, or an option without its value, prints this usage and exits 2.
+
+namespace {
+
+    struct Options
+    {
+        std::vector<int> sizes = { 257, 1025, 2001 };
+        std::vector<int> threads;
+        double minTime = 0.5;
+        std::string output;
+    };
+
+    std::vector<int> parseList(const char* text)
+    {
+        std::vector<int> values;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ','))
+            values.push_back(std::atoi(item.c_str()));
+        return values;
+    }
+
+    [[noreturn]] void exitWithUsage(const char* program)
+    {
+        std::fprintf(stderr, "usage: %s [--sizes 257,1025,2001] [--threads 1,4] [--min-time 0.5] [--output results.json]\n", program);
+        std::exit(2);
+    }
+
+    Options parseOptions(int argc, char** argv)
+    {
+        Options options;
+        for (int i = 1; i < argc; i += 2)
+        {
+            const bool known = std::strcmp(argv[i], "--sizes") == 0 || std::strcmp(argv[i], "--threads") == 0
+                || std::strcmp(argv[i], "--min-time") == 0 || std::strcmp(argv[i], "--output") == 0;
+            if (!known)
+            {
+                std::fprintf(stderr, "unknown option %s\n", argv[i]);
+                exitWithUsage(argv[0]);
+            }
+            if (i + 1 == argc)
+            {
+                std::fprintf(stderr, "%s needs a value\n", argv[i]);
+                exitWithUsage(argv[0]);
+            }
+
+            if (std::strcmp(argv[i], "--sizes") == 0)
+                options.sizes = parseList(argv[i + 1]);
+            else if (std::strcmp(argv[i], "--threads") == 0)
+                options.threads = parseList(argv[i + 1]);
+            else if (std::strcmp(argv[i], "--min-time") == 0)
+                options.minTime = std::atof(argv[i + 1]);
+            else
+                options.output = argv[i + 1];
+        }
+
+        if (options.threads.empty())
+        {
+            options.threads.push_back(1);
+            const int hardwareThreads = static_cast<int>(std::thread::hardware_concurrency());
+            if (hardwareThreads > 1)
+                options.threads.push_back(hardwareThreads);
+        }
+        return options;
+    }
+
+    // Largest coordinate difference between the vector path and its scalar fallback.
+    // Reported on stderr when over tolerance, which makes the run fail.
+    bool checkBatch(const char* name, const Point3dBatchf& reference, const Point3dBatchf& result, float tolerance)
+    {
+        float error = 0.f;
+        for (size_t i = 0; i < reference.size(); ++i)
+            error = std::max({ error, std::abs(reference.x[i] - result.x[i]), std::abs(reference.y[i] - result.y[i]), std::abs(reference.z[i] - result.z[i]) });
+
+        if (error > tolerance)
+            std::fprintf(stderr, "%s: off by %g from the scalar path\n", name, error);
+        return error <= tolerance;
+    }
+
+    // The SSE Mat4<float> product against the generic one, in double
+    bool checkMatrixProduct()
+    {
+        const float angles[] = { 0.3f, -1.2f, 2.5f };
+        const Mat4<float> product = Mat4<float>::translation(0.f, 0.f, -5.f) * Mat4<float>::rotationY(angles[0]) * Mat4<float>::rotationX(angles[1]) * Mat4<float>::rotationZ(angles[2]);
+        const Mat4<double> reference = Mat4<double>::translation(0., 0., -5.) * Mat4<double>::rotationY(angles[0]) * Mat4<double>::rotationX(angles[1]) * Mat4<double>::rotationZ(angles[2]);
+
+        double error = 0.;
+        for (int i = 0; i < 16; ++i)
+            error = std::max(error, std::abs(product.getData()[i] - reference.getData()[i]));
+
+        if (error > 1e-5)
+            std::fprintf(stderr, "mat4 product: off by %g from the scalar product\n", error);
+        return error <= 1e-5;
+    }
+
+    // Packs every slot of every LOD level, in parallel over the slots like Map::load
+    void packAllSlots(const Heightfield<float>& field, const terrain::LodQuadtree& lod, const terrain::HeightQuantizer& quantizer, std::vector<terrain::TerrainVertex>& out)
+    {
+        out.resize(static_cast<size_t>(lod.getSlotCount()) * terrain::ChunkVertexCount);
+        utils::ThreadPoolInstance::GetInstance()->parallelFor(0, lod.getSlotCount(), 1, [&](size_t first, size_t last) {
+            for (int slot = static_cast<int>(first); slot < static_cast<int>(last); ++slot)
+            {
+                const auto& level = lod.getLevel(lod.getSlotLevel(slot));
+                terrain::packChunk(field, level.grid, lod.getSlotChunk(slot), level.stride, quantizer, out.data() + static_cast<size_t>(slot) * terrain::ChunkVertexCount);
+            }
+        });
+    }
+
+}
+
+int main(int argc, char** argv)
+{
+    const Options options = parseOptions(argc, argv);
+    const FractalNoise noise;
+    const GraphNoise<noise::presets::Mountains> mountains(noise::presets::makeMountains());
+
+    // the same preset as src/assets/presets/mountains.noise, built at runtime
+    std::istringstream mountainsPreset(
+        "control = fbm x z octaves=2 frequency=0.05 amplitude=1\n"
+        "lowlands = fbm x z octaves=6 amplitude=0.25\n"
+        "warpX = fbm x z octaves=2 frequency=0.1 seed=0x68e31da4\n"
+        "warpZ = fbm x z octaves=2 frequency=0.1 seed=0xb5297a4d\n"
+        "offsetX = scale_bias warpX scale=2\n"
+        "offsetZ = scale_bias warpZ scale=2\n"
+        "warpedX = add x offsetX\n"
+        "warpedZ = add z offsetZ\n"
+        "ridges = ridged warpedX warpedZ octaves=6 frequency=0.15 amplitude=0.6\n"
+        "mixed = select control lowlands ridges threshold=0.1 falloff=0.2\n"
+        "height = scale_bias mixed bias=-0.3\n"
+        "output height\n");
+    const noise::RuntimeGraph mountainsGraph = noise::RuntimeGraph::parse(mountainsPreset);
+    const float spacing = 0.01f;
+    const float baseHeight = -1.f;
+
+    std::vector<bench::Result> results;
+    bool valid = checkMatrixProduct();
+    auto run = [&](bench::Result result, const char* unit = "vertex") {
+        result.unit = unit;
+        bench::report(result);
+        results.push_back(std::move(result));
+    };
+
+    {
+        // chunk index buffer: shared by every chunk, built once
+        std::vector<std::uint16_t> indices;
+        run(bench::measure("strip_indices", terrain::ChunkVertices, 1, terrain::ChunkVertexCount,
+            terrain::buildStripIndices(terrain::ChunkVertices).size() * sizeof(std::uint16_t), options.minTime, [&] {
+                indices = terrain::buildStripIndices(terrain::ChunkVertices);
+            }));
+    }
+
+    for (int size : options.sizes)
+    {
+        const size_t vertices = static_cast<size_t>(size) * size;
+        Heightfield<float> field(size, size, spacing);
+
+        // reference for the SIMD noise: one thread, scalar backend
+        utils::ThreadPoolInstance::GetInstance()->setWorkerCount(0);
+        run(bench::measure("heights_scalar", size, 1, vertices, vertices * sizeof(float), options.minTime, [&] {
+            for (int row = 0; row < size; ++row)
+                noise::fbmLine<simd::Scalar>(noise.getSettings(), field.getOriginX(), field.getZ(row), spacing, 0.f, 0, size, field.getRow(row));
+        }));
+
+        // SoA batches of the grid positions, each operation against its scalar fallback
+        {
+            Point3dBatchf positions(vertices);
+            for (int row = 0; row < size; ++row)
+                for (int column = 0; column < size; ++column)
+                    positions.set(field.index(column, row), field.getPosition(column, row));
+
+            const Mat4<float> model = Mat4<float>::translation(0.f, 0.f, -5.f) * Mat4<float>::rotationY(0.3f) * Mat4<float>::rotationX(-1.2f);
+            Point3dBatchf reference;
+            Point3dBatchf result;
+
+            run(bench::measure("transform_scalar", size, 1, vertices, vertices * 3 * sizeof(float), options.minTime, [&] {
+                batch::transformPoints<simd::Scalar>(model, positions, reference);
+            }));
+            run(bench::measure("transform", size, 1, vertices, vertices * 3 * sizeof(float), options.minTime, [&] {
+                batch::transformPoints(model, positions, result);
+            }));
+            valid &= checkBatch("transform", reference, result, 1e-5f);
+
+            run(bench::measure("normalize_scalar", size, 1, vertices, vertices * 3 * sizeof(float), options.minTime, [&] {
+                batch::normalize<simd::Scalar>(positions, reference);
+            }));
+            run(bench::measure("normalize", size, 1, vertices, vertices * 3 * sizeof(float), options.minTime, [&] {
+                batch::normalize(positions, result);
+            }));
+            valid &= checkBatch("normalize", reference, result, 1e-5f);
+
+            Point3dBatchf directions;
+            batch::transformDirections(model, positions, directions);
+            batch::cross<simd::Scalar>(positions, directions, reference);
+            batch::cross(positions, directions, result);
+            valid &= checkBatch("cross", reference, result, 1e-5f);
+        }
+
+        for (int threads : options.threads)
+        {
+            utils::ThreadPoolInstance::GetInstance()->setWorkerCount(static_cast<size_t>(std::max(threads, 1) - 1));
+
+            run(bench::measure("heights", size, threads, vertices, vertices * sizeof(float), options.minTime, [&] {
+                terrain::generateHeights(field, noise, baseHeight);
+            }));
+
+            // the compile-time composed mountain preset: warp, ridges and a select in one kernel
+            run(bench::measure("heights_graph", size, threads, vertices, vertices * sizeof(float), options.minTime, [&] {
+                terrain::generateHeights(field, mountains, baseHeight);
+            }));
+
+            // the same preset as a runtime graph, one node at a time over blocks of points
+            run(bench::measure("heights_runtime", size, threads, vertices, vertices * sizeof(float), options.minTime, [&] {
+                terrain::generateHeights(field, mountainsGraph, baseHeight);
+            }));
+
+            run(bench::measure("normals_gradient", size, threads, vertices, vertices * 3 * sizeof(float), options.minTime, [&] {
+                terrain::computeGradientNormals(field);
+            }));
+
+            run(bench::measure("normals_face", size, threads, vertices, vertices * 3 * sizeof(float), options.minTime, [&] {
+                terrain::computeFaceNormals(field);
+            }));
+
+            // one batch of droplets per run on a copy, reported per droplet. A droplet step
+            // reads the 4 heights around both its positions and at most the brush footprint,
+            // read and written: bytes for droplets living maxLifetime.
+            terrain::ErosionSettings erosionSettings;
+            erosionSettings.dropletCount = erosionSettings.batchSize;
+            std::size_t brushCells = 0;
+            for (int dz = -erosionSettings.radius; dz <= erosionSettings.radius; ++dz)
+                for (int dx = -erosionSettings.radius; dx <= erosionSettings.radius; ++dx)
+                    brushCells += dx * dx + dz * dz <= erosionSettings.radius * erosionSettings.radius;
+            const std::size_t dropletBytes = static_cast<std::size_t>(erosionSettings.maxLifetime) * (8 + 2 * brushCells) * sizeof(float);
+            Heightfield<float> eroded = field;
+            run(bench::measure("erosion", size, threads, erosionSettings.batchSize, erosionSettings.batchSize * dropletBytes, options.minTime, [&] {
+                terrain::HydraulicErosion erosion(erosionSettings);
+                erosion.erodeAll(eroded);
+            }), "droplet");
+
+            // one pass of the thermal stencil per run, reported per sample and step. Every run
+            // starts again from the same heights with all tiles active: on a field at rest
+            // the inactive tiles would only be copied. The restore is timed as well.
+            terrain::ThermalErosion thermal;
+            const int thermalSteps = thermal.getSettings().stepsPerPass;
+            Heightfield<float> slopes = field;
+            run(bench::measure("thermal", size, threads, vertices * thermalSteps, vertices * thermalSteps * sizeof(float), options.minTime, [&] {
+                std::copy(field.getHeights(), field.getHeights() + vertices, slopes.getHeights());
+                thermal.invalidate({ 0, size, 0, size });
+                thermal.run(slopes, thermalSteps);
+            }), "sample-step");
+
+            terrain::computeGradientNormals(field);
+            terrain::LodQuadtree lod;
+            lod.build(field);
+            run(bench::measure("lod_build", size, threads, vertices, lod.getSlotCount() * sizeof(terrain::Aabb), options.minTime, [&] {
+                lod.build(field);
+            }));
+
+            const terrain::HeightQuantizer quantizer = terrain::computeHeightRange(field);
+            const size_t packedVertices = static_cast<size_t>(lod.getSlotCount()) * terrain::ChunkVertexCount;
+            std::vector<terrain::TerrainVertex> packed;
+            run(bench::measure("pack", size, threads, packedVertices, packedVertices * sizeof(terrain::TerrainVertex), options.minTime, [&] {
+                packAllSlots(field, lod, quantizer, packed);
+            }));
+
+            // everything Map::load computes before its GL calls
+            run(bench::measure("map_build", size, threads, vertices, packedVertices * sizeof(terrain::TerrainVertex), options.minTime, [&] {
+                Heightfield<float> map(size, size, spacing);
+                terrain::generateHeights(map, noise, baseHeight);
+                terrain::computeGradientNormals(map);
+                terrain::LodQuadtree mapLod;
+                mapLod.build(map);
+                packAllSlots(map, mapLod, terrain::computeHeightRange(map), packed);
+            }));
+        }
+    }
+
+    std::FILE* out = options.output.empty() ? stdout : std::fopen(options.output.c_str(), "w");
+    if (out == nullptr)
+    {
+        std::fprintf(stderr, "cannot write %s\n", options.output.c_str());
+        return EXIT_FAILURE;
+    }
+
+    bench::writeJson(out, results, simd::getIsaName(terrain::getKernels().isa), std::thread::hardware_concurrency());
+    if (out != stdout)
+        std::fclose(out);
+    return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -45,11 +45,13 @@ if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
   set_property(CACHE CMAKE_BUILD_TYPE APPEND PROPERTY STRINGS Profile)
 endif()
 
-if(!MSVC)
+# Off by default: the binaries must run on any x86-64, the hot kernels pick their
+# instruction set at startup instead (engine/terrain/Kernels.h)
+if(NOT MSVC)
     include(CheckCXXCompilerFlag)
     CHECK_CXX_COMPILER_FLAG("-march=native" COMPILER_SUPPORTS_MARCH_NATIVE)
     if(COMPILER_SUPPORTS_MARCH_NATIVE)
-      option(ENABLE_NATIVE_BUILD "Build with -march=native" ON)
+      option(ENABLE_NATIVE_BUILD "Build everything with -march=native (not portable)" OFF)
       if(ENABLE_NATIVE_BUILD)
         add_compile_options(-march=native)
      endif()
@@ -5,20 +5,28 @@
 
 #include "utils/math/Math.h"
 
+#include "engine/graphics/buffers/UploadService.h"
+#include "engine/profiling/Profiler.h"
 #include "engine/scene/Scene.h"
 #include "Game.h"
 
+#if TERRAIN_PROFILER
+#include <imgui-SFML.h>
+#endif
+
 namespace engine {
 
 
     Game::~Game()
     {
+        stopSimulation();
         clearScenes();
     }
 
     void Game::run(sf::VideoMode videoMode, std::string windowTitle, sf::Uint32 style, const size_t indexStartScene)
     {
         m_pCurrentScene = m_scenes.at(indexStartScene);
+        m_mainThread = std::this_thread::get_id();
 
         assert(m_pCurrentScene != nullptr);
 
@@ -31,20 +39,62 @@ namespace engine {
         if (glewInit())
             throw std::runtime_error("Error");
 
+#if TERRAIN_PROFILER
+        ImGui::SFML::Init(m_window);
+#endif
+
         m_pCurrentScene->onBeginPlay();
 
+        if (m_simulationRate > 0.f)
+        {
+            m_simulationOrigin = std::chrono::steady_clock::now();
+            m_simulating = true;
+            m_simulationThread = std::thread(&Game::simulate, this);
+        }
+
         sf::Clock DeltaTimeClock;
 
         while (m_window.isOpen()) {
-            float deltaTime = DeltaTimeClock.restart().asSeconds();
+            sf::Time frameTime = DeltaTimeClock.restart();
+            float deltaTime = frameTime.asSeconds();
+
+#if TERRAIN_PROFILER
+            ProfilerInstance::GetInstance()->beginFrame();
+#endif
 
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+            // uploads the GPU finished since the last frame, without waiting for the others
+            UploadServiceInstance::GetInstance()->update();
+
             processInput();
-            update(deltaTime);
+#if TERRAIN_PROFILER
+            ImGui::SFML::Update(m_window, frameTime);
+#endif
+            if (m_simulationThread.joinable())
+                m_pCurrentScene->prepareRender(getSimulationTime() - InterpolationDelay / m_simulationRate);
+            else
+                update(deltaTime);
+
+            {
+                PROFILE_SCOPE("frame tasks");
+                m_frameTasks.run();
+            }
             render();
+
+#if TERRAIN_PROFILER
+            ProfilerInstance::GetInstance()->endFrame();
+#endif
         }
 
+        stopSimulation();
+
+#if TERRAIN_PROFILER
+        ImGui::SFML::Shutdown();
+#endif
+
+        // the upload context goes before the window's
+        UploadServiceInstance::GetInstance()->stop();
     }
 
     sf::RenderWindow* Game::getWindow()
@@ -68,6 +118,23 @@ namespace engine {
     }
 
 
+    void Game::setSimulationRate(float ticksPerSecond)
+    {
+        m_simulationRate = ticksPerSecond;
+    }
+
+    double Game::getSimulationTime() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_simulationOrigin).count();
+    }
+
+    TaskGraph& Game::getFrameTasks()
+    {
+        // Main tasks need the GL context, and the graph is not shared between threads
+        assert(std::this_thread::get_id() == m_mainThread);
+        return m_frameTasks;
+    }
+
     void Game::clearScenes()
     {
         for (IScene* pScene : m_scenes)
@@ -93,12 +160,62 @@ namespace engine {
         m_window.setActive(true);
     }
 
+    void Game::simulate()
+    {
+        using Clock = std::chrono::steady_clock;
+        const float stepSeconds = 1.f / m_simulationRate;
+        const auto step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(stepSeconds));
+        auto tickEnd = [&](long long tick) {
+            return m_simulationOrigin + tick * step;
+        };
+
+        long long tick = 0;
+        while (m_simulating.load(std::memory_order_acquire))
+        {
+            // every tick whose end has passed, a few at most in a row
+            for (int ticks = 0; ticks < MaxCatchUpTicks && Clock::now() >= tickEnd(tick + 1); ++ticks)
+            {
+                PROFILE_SCOPE("simulation tick");
+                ++tick;
+                m_pCurrentScene->simulate(stepSeconds, tick * static_cast<double>(stepSeconds));
+            }
+
+            // still behind: the ticks that could not be simulated are skipped instead of
+            // spiralling, up to the one ending now. The clock goes on, so the snapshot
+            // times jump ahead while the render time keeps increasing.
+            if (Clock::now() >= tickEnd(tick + 1))
+                tick = (Clock::now() - m_simulationOrigin) / step - 1;
+
+            std::this_thread::sleep_until(tickEnd(tick + 1));
+        }
+    }
+
+    void Game::stopSimulation()
+    {
+        if (!m_simulationThread.joinable())
+            return;
+
+        m_simulating = false;
+        m_simulationThread.join();
+    }
+
     void Game::processInput()
     {
+        PROFILE_SCOPE("input");
 
         sf::Event event;
         while (m_window.pollEvent(event))
         {
+#if TERRAIN_PROFILER
+            ImGui::SFML::ProcessEvent(m_window, event);
+
+            // F1 shows the profiler overlay, F2 captures a trace of the next frames
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F1)
+                ProfilerInstance::GetInstance()->setOverlayVisible(!ProfilerInstance::GetInstance()->isOverlayVisible());
+            else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F2)
+                ProfilerInstance::GetInstance()->captureTrace(120, "trace.json");
+#endif
+
             if (event.type == sf::Event::Closed)
                 m_window.close();
             else if (event.type == sf::Event::Resized)
@@ -113,19 +230,45 @@ namespace engine {
 
     void Game::update(const float& deltaTime)
     {
+        PROFILE_SCOPE("update");
         m_pCurrentScene->update(deltaTime);
     }
 
     void Game::render()
     {
-        // clear the buffers
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        m_window.clear();
+        PROFILE_SCOPE("render");
+
+        {
+            PROFILE_GPU_SCOPE("frame");
 
-        m_pCurrentScene->render();
+            // clear the buffers
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            m_window.clear();
 
-        glFlush();
-        m_window.display();
+            {
+                PROFILE_SCOPE("scene render");
+                m_pCurrentScene->render();
+            }
+
+#if TERRAIN_PROFILER
+            // SFML draws ImGui with its own legacy GL states: leave it a clean slate
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+            glUseProgram(0);
+
+            m_window.pushGLStates();
+            ProfilerInstance::GetInstance()->drawOverlay();
+            ImGui::SFML::Render(m_window);
+            m_window.popGLStates();
+#endif
+        }
+
+        {
+            PROFILE_SCOPE("present");
+            glFlush();
+            m_window.display();
+        }
     }
 
 
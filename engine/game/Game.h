@@ -1,6 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #include <utils/design_patterns/Singleton.h>
+#include <engine/jobs/TaskGraph.h>
 #include <SFML/Graphics.hpp>
 #include <SFML/Window.hpp>
 #include <GL/glew.h>
@@ -30,6 +35,27 @@ namespace engine {
 
         void clearScenes();
 
+        // ticksPerSecond > 0, before run(): the current scene simulates on its own thread
+        // at that fixed rate (IScene::simulate), while the main thread polls the input
+        // and renders the simulation InterpolationDelay ticks in the past
+        // (IScene::prepareRender), so that ticks of uneven cost don't show. 0, the
+        // default, updates and renders in turn on the main thread.
+        void setSimulationRate(float ticksPerSecond);
+
+        // Seconds on the simulation clock
+        double getSimulationTime() const;
+
+        // Tasks of the current frame: the scene adds to them from update() or
+        // prepareRender(), and they run right after, before render(). Main thread only,
+        // never from IScene::simulate().
+        TaskGraph& getFrameTasks();
+
+        // ticks the render runs behind the simulation: room for a tick as long as a step
+        static constexpr double InterpolationDelay = 2.0;
+
+        // ticks run back to back before the simulation gives up catching up
+        static constexpr int MaxCatchUpTicks = 4;
+
     private:
         Game();
         Game(const Game&) = delete;
@@ -39,12 +65,26 @@ namespace engine {
         void update(const float& deltaTime);
         void render();
 
+        void simulate();
+        void stopSimulation();
+
 
         // attributes
         sf::RenderWindow m_window;
 
         std::vector<IScene*> m_scenes;
         IScene* m_pCurrentScene = nullptr;
+
+        TaskGraph m_frameTasks;
+        std::thread::id m_mainThread;   // the one in run()
+
+        float m_simulationRate = 0.f;
+        std::thread m_simulationThread;
+        std::atomic<bool> m_simulating = false;
+
+        // where the simulation clock starts, set before the simulation thread; never moves,
+        // so that the render time never goes back
+        std::chrono::steady_clock::time_point m_simulationOrigin;
     };
 
     template<typename ...Args>
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+
+namespace engine {
+
+    // States the simulation thread publishes at the end of its ticks, for the render
+    // thread to draw in between: sample() finds the two states around a time and how
+    // far it lies from the first. The last Capacity states are kept, so a render that
+    // runs a few ticks behind the simulation always finds its pair.
+    template<typename T, int Capacity = 4>
+    class SnapshotBuffer
+    {
+    public:
+        // Simulation thread, with times increasing from one call to the next
+        void publish(const T& state, double time)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_newest = (m_newest + 1) % Capacity;
+            m_states[m_newest] = state;
+            m_times[m_newest] = time;
+            m_count = std::min(m_count + 1, Capacity);
+        }
+
+        // Render thread. False until the first publish; then alpha in [0, 1] blends from
+        // previous to next, held at the oldest and newest states kept outside of them.
+        bool sample(double time, T& previous, T& next, float& alpha) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_count == 0)
+                return false;
+
+            // from the newest back to the first state not after time
+            int later = m_newest;
+            for (int i = 1; i < m_count; ++i)
+            {
+                const int earlier = (m_newest - i + Capacity) % Capacity;
+                if (m_times[earlier] <= time)
+                {
+                    previous = m_states[earlier];
+                    next = m_states[later];
+                    alpha = static_cast<float>(std::clamp((time - m_times[earlier]) / (m_times[later] - m_times[earlier]), 0.0, 1.0));
+                    return true;
+                }
+                later = earlier;
+            }
+
+            previous = m_states[later];
+            next = m_states[later];
+            alpha = 0.f;
+            return true;
+        }
+
+    private:
+        mutable std::mutex m_mutex;
+        std::array<T, Capacity> m_states = {};
+        std::array<double, Capacity> m_times = {};
+        int m_newest = -1;
+        int m_count = 0;
+    };
+
+}
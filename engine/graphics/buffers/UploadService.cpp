@@ -0,0 +1,180 @@
+#include "UploadService.h"
+
+#include <SFML/Window/Context.hpp>
+
+#include <cstring>
+#include <limits>
+
+UploadService::~UploadService()
+{
+	stop();
+}
+
+void UploadService::update()
+{
+	m_frameBytes = 0;
+	m_frameFence = nullptr;
+	collect(0);
+}
+
+bool UploadService::hasBudget(size_t bytes) const
+{
+	return m_frameBytes == 0 || m_frameBytes + bytes <= m_frameBudget;
+}
+
+UploadService::Ticket UploadService::uploadBuffer(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	if (!m_worker.joinable())
+	{
+		m_stopping = false;
+		m_worker = std::thread(&UploadService::run, this);
+	}
+
+	Job job;
+	job.ticket = m_nextTicket++;
+	job.buffer = buffer;
+	job.offset = offset;
+	job.size = size;
+	job.data = data;
+
+	if (m_frameFence == nullptr)
+	{
+		m_frameFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+		// the worker waits on the fence: it has to reach the GPU without waiting for the end of the frame
+		glFlush();
+	}
+	job.drawn = m_frameFence;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(job);
+	}
+	m_wake.notify_one();
+
+	m_frameBytes += static_cast<size_t>(size);
+	return job.ticket;
+}
+
+void UploadService::finish()
+{
+	while (!isComplete(m_nextTicket - 1))
+	{
+		collect(std::numeric_limits<GLuint64>::max());
+		std::this_thread::yield();
+	}
+}
+
+void UploadService::stop()
+{
+	if (!m_worker.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_one();
+	m_worker.join();
+
+	finish();
+}
+
+void UploadService::collect(GLuint64 timeout)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	while (!m_done.empty())
+	{
+		const GLenum status = glClientWaitSync(m_done.front().copied, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+
+		glDeleteSync(m_done.front().copied);
+		m_completed = m_done.front().ticket;
+		m_done.pop_front();
+	}
+}
+
+void UploadService::run()
+{
+	// SFML shares every context it creates: this one sees the render thread's objects
+	sf::Context context;
+
+	GLuint staging[StagingBufferCount] = {};
+	GLsizeiptr stagingSizes[StagingBufferCount] = {};
+	GLsync stagingFences[StagingBufferCount] = {};
+	glGenBuffers(StagingBufferCount, staging);
+	int next = 0;
+
+	// jobs come in order: once one brings a new frame fence, no later job uses the old one
+	GLsync waited = nullptr;
+
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [&] { return m_stopping || !m_jobs.empty(); });
+			if (m_jobs.empty())
+				break;
+			job = m_jobs.front();
+			m_jobs.pop_front();
+		}
+
+		// on the GPU, once per frame: the draws queued before the frame's uploads may read
+		// what they overwrite
+		if (job.drawn != waited)
+		{
+			glWaitSync(job.drawn, 0, GL_TIMEOUT_IGNORED);
+			if (waited != nullptr)
+				glDeleteSync(waited);
+			waited = job.drawn;
+		}
+
+		// the oldest staging buffer, once the copy out of it is over
+		const int index = next;
+		next = (next + 1) % StagingBufferCount;
+		if (stagingFences[index] != nullptr)
+		{
+			glClientWaitSync(stagingFences[index], GL_SYNC_FLUSH_COMMANDS_BIT, std::numeric_limits<GLuint64>::max());
+			glDeleteSync(stagingFences[index]);
+		}
+
+		glBindBuffer(GL_COPY_READ_BUFFER, staging[index]);
+		if (stagingSizes[index] < job.size)
+		{
+			stagingSizes[index] = job.size;
+			glBufferData(GL_COPY_READ_BUFFER, job.size, nullptr, GL_STREAM_COPY);
+		}
+
+		// unsynchronized: the fence above already says the GPU is done with this buffer
+		void* mapped = glMapBufferRange(GL_COPY_READ_BUFFER, 0, job.size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		std::memcpy(mapped, job.data, static_cast<size_t>(job.size));
+		glUnmapBuffer(GL_COPY_READ_BUFFER);
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, job.buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, job.offset, job.size);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		stagingFences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		const GLsync copied = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_done.push_back({ job.ticket, copied });
+	}
+
+	if (waited != nullptr)
+		glDeleteSync(waited);
+
+	for (int index = 0; index < StagingBufferCount; ++index)
+	{
+		if (stagingFences[index] != nullptr)
+		{
+			glClientWaitSync(stagingFences[index], GL_SYNC_FLUSH_COMMANDS_BIT, std::numeric_limits<GLuint64>::max());
+			glDeleteSync(stagingFences[index]);
+		}
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glDeleteBuffers(StagingBufferCount, staging);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "utils/design_patterns/Singleton.h"
+
+// Buffer uploads run by a worker thread on its own GL context, shared with the render
+// one, so that big transfers never stall a frame.
+//
+// The first upload of a frame puts a fence behind the draws already issued, flushed
+// once and shared by every upload of the frame: the render thread must not draw from a
+// destination once it queued an upload to it. The worker waits on that fence on the
+// GPU, so that nothing still being drawn from is overwritten, copies the data into the
+// next buffer of a ring of staging buffers and from there into the destination, then
+// fences the copy. update() polls those fences
+// without waiting: an upload isComplete() once the GPU has run it, and only then may
+// the render thread draw what it wrote. Uploads complete in the order they were queued.
+//
+// Every method but the worker's own loop is for the render thread, with its context
+// current. The worker starts with the first upload.
+class UploadService
+{
+	friend class utils::Singleton<UploadService>;
+
+public:
+	using Ticket = std::uint64_t;
+
+	static constexpr int StagingBufferCount = 4;
+
+	// Bytes the render thread may queue per frame; one upload always goes through
+	static constexpr size_t DefaultFrameBudget = size_t(8) << 20;
+
+	~UploadService();
+
+	// Once per frame, before the frame queues anything: collects the finished uploads
+	// and resets the frame budget. Never waits.
+	void update();
+
+	bool hasBudget(size_t bytes) const;
+	void setFrameBudget(size_t bytes) { m_frameBudget = bytes; }
+	size_t getQueuedBytes() const { return m_frameBytes; }
+
+	// Copies size bytes from data into buffer at offset. data must stay valid and
+	// unchanged until isComplete(ticket).
+	Ticket uploadBuffer(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+
+	bool isComplete(Ticket ticket) const { return ticket <= m_completed; }
+
+	// Waits until every queued upload is complete, before deleting a destination
+	void finish();
+
+	// Runs what is queued, then ends the worker and its context. The render context
+	// must still be alive.
+	void stop();
+
+private:
+	UploadService() = default;
+	UploadService(const UploadService&) = delete;
+
+	struct Job
+	{
+		Ticket ticket = 0;
+		GLuint buffer = 0;
+		GLintptr offset = 0;
+		GLsizeiptr size = 0;
+		const void* data = nullptr;
+		GLsync drawn = nullptr;        // the frame fence, deleted by the worker
+	};
+
+	struct Done
+	{
+		Ticket ticket = 0;
+		GLsync copied = nullptr;
+	};
+
+	void run();
+
+	// Completes the finished uploads in order, waiting up to timeout nanoseconds for each
+	void collect(GLuint64 timeout);
+
+	std::thread m_worker;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::deque<Job> m_jobs;
+	std::deque<Done> m_done;
+	bool m_stopping = false;
+
+	// render thread only
+	Ticket m_nextTicket = 1;
+	Ticket m_completed = 0;
+	size_t m_frameBudget = DefaultFrameBudget;
+	size_t m_frameBytes = 0;
+	GLsync m_frameFence = nullptr;     // of the current frame, created by its first upload
+};
+
+using UploadServiceInstance = utils::Singleton<UploadService>;
@@ -0,0 +1,37 @@
+#include "FrameUniforms.h"
+
+#include <cstring>
+
+FrameUniforms::FrameUniforms()
+{
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, Binding, m_buffer);
+}
+
+FrameUniforms::~FrameUniforms()
+{
+	glDeleteBuffers(1, &m_buffer);
+}
+
+void FrameUniforms::update(const Mat4<float>& view, const Mat4<float>& projection, const Point3d<float>& cameraPosition, const Point3d<float>& lightDirection, const Point3d<float>& lightColor)
+{
+	Block block = {};
+	std::memcpy(block.view, view.getData(), sizeof(block.view));
+	std::memcpy(block.projection, projection.getData(), sizeof(block.projection));
+	block.cameraPosition[0] = cameraPosition.x;
+	block.cameraPosition[1] = cameraPosition.y;
+	block.cameraPosition[2] = cameraPosition.z;
+	block.lightDirection[0] = lightDirection.x;
+	block.lightDirection[1] = lightDirection.y;
+	block.lightDirection[2] = lightDirection.z;
+	block.lightColor[0] = lightColor.x;
+	block.lightColor[1] = lightColor.y;
+	block.lightColor[2] = lightColor.z;
+
+	// the binding point is shared with other buffers' users: claim it again every frame
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+	glBindBufferBase(GL_UNIFORM_BUFFER, Binding, m_buffer);
+}
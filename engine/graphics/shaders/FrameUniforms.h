@@ -0,0 +1,40 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "utils/design_patterns/Singleton.h"
+#include "utils/math/Math.h"
+
+// Camera and light of the frame, in a std140 uniform buffer bound once at Binding.
+// Every program declaring the "Frame" block (see map.vert and map.frag) reads it, so
+// they are uploaded once per frame instead of once per program and draw.
+class FrameUniforms
+{
+	friend class utils::Singleton<FrameUniforms>;
+
+public:
+	static constexpr GLuint Binding = 0;
+
+	~FrameUniforms();
+
+	// Needs a current GL context
+	void update(const Mat4<float>& view, const Mat4<float>& projection, const Point3d<float>& cameraPosition, const Point3d<float>& lightDirection, const Point3d<float>& lightColor);
+
+private:
+	FrameUniforms();
+	FrameUniforms(const FrameUniforms&) = delete;
+
+	// Mirrors the std140 layout of the block: vec3 are padded to vec4
+	struct Block
+	{
+		GLfloat view[16];
+		GLfloat projection[16];
+		GLfloat cameraPosition[4];
+		GLfloat lightDirection[4];
+		GLfloat lightColor[4];
+	};
+
+	GLuint m_buffer = 0;
+};
+
+using FrameUniformsInstance = utils::Singleton<FrameUniforms>;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ShaderProgram.h"
+
+// Phong material of map.frag
+struct Material
+{
+	Point3d<float> color = Point3d<float>(0.f, 1.f, 0.f);
+	float ambient = 0.3f;
+	float diffuse = 0.7f;
+	float specular = 1.f;
+	float specularSmoothness = 2.f;
+};
+
+// Locations of the material uniforms of a program, looked up once after linking
+struct MaterialUniforms
+{
+	GLint color = -1;
+	GLint ambient = -1;
+	GLint diffuse = -1;
+	GLint specular = -1;
+	GLint specularSmoothness = -1;
+
+	MaterialUniforms() = default;
+
+	explicit MaterialUniforms(const ShaderProgram& program)
+		: color(program.getUniformLocation("material.color"))
+		, ambient(program.getUniformLocation("material.ambient"))
+		, diffuse(program.getUniformLocation("material.diffuse"))
+		, specular(program.getUniformLocation("material.specular"))
+		, specularSmoothness(program.getUniformLocation("material.specularSmoothness"))
+	{}
+
+	// Only the values that differ from the last ones set reach GL
+	void apply(ShaderProgram& program, const Material& material) const
+	{
+		program.setUniform(color, material.color);
+		program.setUniform(ambient, material.ambient);
+		program.setUniform(diffuse, material.diffuse);
+		program.setUniform(specular, material.specular);
+		program.setUniform(specularSmoothness, material.specularSmoothness);
+	}
+};
@@ -1,11 +1,17 @@
 #include "Shader.h"
+#include "ShaderCache.h"
 #include <GL/glew.h>
 
 #include <fstream>
 #include <iostream>
 #include <sstream>
 
-unsigned Shader::loadShaders(ShaderInfo* shaderInfo)
+ShaderProgram Shader::loadShaders(ShaderInfo* shaderInfo)
+{
+	return ShaderCacheInstance::GetInstance()->load(shaderInfo);
+}
+
+ShaderProgram Shader::compileShaders(ShaderInfo* shaderInfo, const std::vector<std::string>& sources)
 {
 	if (shaderInfo == nullptr)
 		throw std::runtime_error("ShaderInfo is null");
@@ -17,8 +23,7 @@ unsigned Shader::loadShaders(ShaderInfo* shaderInfo)
 	{
 		auto shaderId = glCreateShader(entry->type);
 		entry->shaderId = shaderId;
-		auto str = readShader(entry->filename);
-		const auto source = str.c_str();
+		const auto source = sources[entry - shaderInfo].c_str();
 
 		if (source == nullptr)
 		{
@@ -28,7 +33,7 @@ unsigned Shader::loadShaders(ShaderInfo* shaderInfo)
 				entry->shaderId = 0;
 			}
 
-			return 0;
+			return ShaderProgram();
 		}
 
 		glShaderSource(shaderId, 1, &source, nullptr);
@@ -48,13 +53,15 @@ unsigned Shader::loadShaders(ShaderInfo* shaderInfo)
 			delete[] log;
 			log = nullptr;
 
-			return 0;
+			return ShaderProgram();
 		}
 
 		glAttachShader(program, shaderId);
 		++entry;
 	}
 
+	// ShaderCache reads the linked binary back
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(program);
 	GLint linked;
 	glGetProgramiv(program, GL_LINK_STATUS, &linked);
@@ -74,10 +81,10 @@ unsigned Shader::loadShaders(ShaderInfo* shaderInfo)
 			entry->shaderId = 0;
 		}
 
-		return 0;
+		return ShaderProgram();
 	}
 
-	return program;
+	return ShaderProgram(program);
 }
 
 std::string Shader::readShader(const char* filename)
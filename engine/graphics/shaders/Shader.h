@@ -1,5 +1,8 @@
 #pragma once
 #include <string>
+#include <vector>
+
+#include "ShaderProgram.h"
 
 struct ShaderInfo
 {
@@ -10,10 +13,15 @@ struct ShaderInfo
 
 struct Shader
 {
-	static unsigned int loadShaders(ShaderInfo* shaderInfo);
+	// Program of the shaders listed up to a GL_NONE entry, through ShaderCacheInstance:
+	// each set is compiled at most once per process, and not at all when its binary
+	// from an earlier launch still fits the driver.
+	static ShaderProgram loadShaders(ShaderInfo* shaderInfo);
 
+	// Compiles and links sources, one per entry of shaderInfo. The program is invalid
+	// (id 0) when a stage fails to compile or the link fails.
+	static ShaderProgram compileShaders(ShaderInfo* shaderInfo, const std::vector<std::string>& sources);
 
-private:
 	static std::string readShader(const char* filename);
 };
 
@@ -0,0 +1,182 @@
+#include "ShaderCache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+	// Written before every binary: rejects files of another layout without asking the driver
+	constexpr std::uint32_t BinaryMagic = 0x42505447;    // "GTPB"
+
+	// FNV-1a, 64 bits
+	std::uint64_t hash(std::uint64_t seed, const void* data, size_t size)
+	{
+		const auto* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			seed ^= bytes[i];
+			seed *= 0x100000001b3ull;
+		}
+		return seed;
+	}
+
+	std::string getString(GLenum name)
+	{
+		const auto* value = reinterpret_cast<const char*>(glGetString(name));
+		return value != nullptr ? value : "";
+	}
+
+}
+
+ShaderCache::ShaderCache()
+{
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	m_isSupported = formatCount > 0;
+	m_driver = getString(GL_VENDOR) + "|" + getString(GL_RENDERER) + "|" + getString(GL_VERSION);
+}
+
+ShaderProgram ShaderCache::load(ShaderInfo* shaderInfo)
+{
+	if (shaderInfo == nullptr)
+		throw std::runtime_error("ShaderInfo is null");
+
+	std::string set;
+	for (auto* entry = shaderInfo; entry->type != GL_NONE; ++entry)
+	{
+		entry->shaderId = 0;
+		set += std::to_string(entry->type) + ":" + entry->filename + ";";
+	}
+
+	std::vector<std::string> sources;
+	auto readSources = [&]()
+	{
+		if (sources.empty())
+			for (auto* entry = shaderInfo; entry->type != GL_NONE; ++entry)
+				sources.push_back(Shader::readShader(entry->filename));
+	};
+
+	if (!m_isSupported)
+	{
+		readSources();
+		return Shader::compileShaders(shaderInfo, sources);
+	}
+
+	auto key = m_keys.find(set);
+	if (key == m_keys.end())
+	{
+		readSources();
+		key = m_keys.emplace(set, getKey(shaderInfo, sources)).first;
+	}
+
+	auto binary = m_binaries.find(key->second);
+	if (binary == m_binaries.end())
+	{
+		Binary stored;
+		if (readBinary(key->second, stored))
+			binary = m_binaries.emplace(key->second, std::move(stored)).first;
+	}
+
+	if (binary != m_binaries.end())
+	{
+		const GLuint program = glCreateProgram();
+		glProgramBinary(program, binary->second.format, binary->second.data.data(), static_cast<GLsizei>(binary->second.data.size()));
+
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (linked)
+			return ShaderProgram(program);
+
+		// drivers may refuse their own binaries after an update that kept the version string
+		glDeleteProgram(program);
+		m_binaries.erase(binary);
+	}
+
+	readSources();
+	ShaderProgram program = Shader::compileShaders(shaderInfo, sources);
+	if (!program.isValid())
+		return program;
+
+	Binary compiled;
+	GLint length = 0;
+	glGetProgramiv(program.getId(), GL_PROGRAM_BINARY_LENGTH, &length);
+	compiled.data.resize(length);
+	glGetProgramBinary(program.getId(), length, &length, &compiled.format, compiled.data.data());
+	if (length > 0)
+	{
+		compiled.data.resize(length);
+		writeBinary(key->second, compiled);
+		m_binaries.emplace(key->second, std::move(compiled));
+	}
+	return program;
+}
+
+std::uint64_t ShaderCache::getKey(ShaderInfo* shaderInfo, const std::vector<std::string>& sources) const
+{
+	std::uint64_t key = hash(0xcbf29ce484222325ull, m_driver.data(), m_driver.size());
+	size_t stage = 0;
+	for (auto* entry = shaderInfo; entry->type != GL_NONE; ++entry, ++stage)
+	{
+		key = hash(key, &entry->type, sizeof(entry->type));
+		key = hash(key, sources[stage].data(), sources[stage].size());
+	}
+	return key;
+}
+
+std::string ShaderCache::getPath(std::uint64_t key) const
+{
+	char name[24];
+	std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return (std::filesystem::path(Directory) / name).string();
+}
+
+bool ShaderCache::readBinary(std::uint64_t key, Binary& binary) const
+{
+	std::ifstream file(getPath(key), std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	const std::streamoff size = file.tellg();
+	std::uint32_t header[2];
+	if (size <= static_cast<std::streamoff>(sizeof(header)))
+		return false;
+
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (header[0] != BinaryMagic)
+		return false;
+
+	binary.format = header[1];
+	binary.data.resize(static_cast<size_t>(size) - sizeof(header));
+	file.read(binary.data.data(), binary.data.size());
+	return static_cast<bool>(file);
+}
+
+void ShaderCache::writeBinary(std::uint64_t key, const Binary& binary) const
+{
+	// a cache that can't be written only costs the next launch a compilation
+	std::error_code error;
+	std::filesystem::create_directories(Directory, error);
+
+	// written aside then renamed, so that another instance never reads half a binary
+	const std::string path = getPath(key);
+	const std::string temporary = path + ".tmp";
+	bool written;
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		const std::uint32_t header[2] = { BinaryMagic, binary.format };
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(binary.data.data(), binary.data.size());
+		written = static_cast<bool>(file);
+	}
+
+	if (written)
+		std::filesystem::rename(temporary, path, error);
+	if (!written || error)
+	{
+		std::cerr << "Shader cache: can't write " << path << std::endl;
+		std::filesystem::remove(temporary, error);
+	}
+}
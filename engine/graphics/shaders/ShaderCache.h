@@ -0,0 +1,56 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/design_patterns/Singleton.h"
+
+#include "Shader.h"
+#include "ShaderProgram.h"
+
+// Linked programs kept as driver binaries (glGetProgramBinary), so that a shader set is
+// compiled once. The binary of a set stays in memory for the rest of the process and is
+// written under Directory, named after a hash of the sources and of the GL vendor,
+// renderer and version: a driver update or an edited source misses the cache instead of
+// loading a stale binary. Binaries the driver rejects are compiled again from source.
+class ShaderCache
+{
+	friend class utils::Singleton<ShaderCache>;
+
+public:
+	static constexpr const char* Directory = "shader_cache";
+
+	// A new program for the shaders listed up to a GL_NONE entry, with its own uniform
+	// state. Needs a current GL context; invalid as Shader::compileShaders.
+	ShaderProgram load(ShaderInfo* shaderInfo);
+
+private:
+	ShaderCache();
+	ShaderCache(const ShaderCache&) = delete;
+
+	struct Binary
+	{
+		GLenum format = 0;
+		std::vector<char> data;
+	};
+
+	std::uint64_t getKey(ShaderInfo* shaderInfo, const std::vector<std::string>& sources) const;
+	std::string getPath(std::uint64_t key) const;
+
+	bool readBinary(std::uint64_t key, Binary& binary) const;
+	void writeBinary(std::uint64_t key, const Binary& binary) const;
+
+	// drivers without binary formats (GL_NUM_PROGRAM_BINARY_FORMATS = 0) always compile
+	bool m_isSupported = false;
+	std::string m_driver;
+
+	// shader set ("type:file;..." of the entries) -> key, so a set loaded again skips reading its sources
+	std::unordered_map<std::string, std::uint64_t> m_keys;
+	std::unordered_map<std::uint64_t, Binary> m_binaries;
+};
+
+using ShaderCacheInstance = utils::Singleton<ShaderCache>;
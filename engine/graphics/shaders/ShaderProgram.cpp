@@ -0,0 +1,190 @@
+#include "ShaderProgram.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+	// Bytes of one value of a uniform type, 0 for the types the cache skips (samplers...)
+	std::size_t getTypeSize(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: case GL_BOOL: return 4;
+		case GL_FLOAT_VEC2: case GL_INT_VEC2: return 8;
+		case GL_FLOAT_VEC3: case GL_INT_VEC3: return 12;
+		case GL_FLOAT_VEC4: case GL_INT_VEC4: return 16;
+		case GL_FLOAT_MAT3: return 36;
+		case GL_FLOAT_MAT4: return 64;
+		default: return 0;
+		}
+	}
+
+}
+
+ShaderProgram::ShaderProgram(GLuint id)
+	: m_id(id)
+{
+	if (m_id != 0)
+		reflect();
+}
+
+ShaderProgram::~ShaderProgram()
+{
+	release();
+}
+
+ShaderProgram::ShaderProgram(ShaderProgram&& other) noexcept
+	: m_id(std::exchange(other.m_id, 0))
+	, m_locations(std::move(other.m_locations))
+	, m_blocks(std::move(other.m_blocks))
+	, m_uniforms(std::move(other.m_uniforms))
+	, m_cache(std::move(other.m_cache))
+{
+}
+
+ShaderProgram& ShaderProgram::operator=(ShaderProgram&& other) noexcept
+{
+	if (this != &other)
+	{
+		release();
+		m_id = std::exchange(other.m_id, 0);
+		m_locations = std::move(other.m_locations);
+		m_blocks = std::move(other.m_blocks);
+		m_uniforms = std::move(other.m_uniforms);
+		m_cache = std::move(other.m_cache);
+	}
+	return *this;
+}
+
+void ShaderProgram::release()
+{
+	if (m_id != 0)
+		glDeleteProgram(m_id);
+	m_id = 0;
+}
+
+void ShaderProgram::reflect()
+{
+	GLint uniformCount = 0;
+	glGetProgramInterfaceiv(m_id, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+
+	GLint maxNameLength = 0;
+	glGetProgramInterfaceiv(m_id, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
+	GLint maxBlockNameLength = 0;
+	glGetProgramInterfaceiv(m_id, GL_UNIFORM_BLOCK, GL_MAX_NAME_LENGTH, &maxBlockNameLength);
+	std::vector<GLchar> name(std::max(maxNameLength, maxBlockNameLength) + 1);
+
+	const GLenum properties[] = { GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION, GL_BLOCK_INDEX };
+	for (GLint i = 0; i < uniformCount; ++i)
+	{
+		GLint values[4] = {};
+		glGetProgramResourceiv(m_id, GL_UNIFORM, i, 4, properties, 4, nullptr, values);
+
+		// members of uniform blocks have no location, they live in buffers
+		if (values[3] != -1 || values[2] < 0)
+			continue;
+
+		glGetProgramResourceName(m_id, GL_UNIFORM, i, static_cast<GLsizei>(name.size()), nullptr, name.data());
+		std::string uniformName(name.data());
+
+		Uniform uniform;
+		uniform.type = static_cast<GLenum>(values[0]);
+		uniform.arraySize = values[1];
+		uniform.cacheSize = uniform.arraySize == 1 ? getTypeSize(uniform.type) : 0;
+		uniform.cacheOffset = m_cache.size();
+		m_cache.resize(m_cache.size() + uniform.cacheSize);
+
+		const GLint location = values[2];
+		m_uniforms[location] = uniform;
+		m_locations[uniformName] = location;
+
+		const std::size_t arraySuffix = uniformName.rfind("[0]");
+		if (arraySuffix != std::string::npos && arraySuffix + 3 == uniformName.size())
+			m_locations[uniformName.substr(0, arraySuffix)] = location;
+	}
+
+	GLint blockCount = 0;
+	glGetProgramInterfaceiv(m_id, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &blockCount);
+	for (GLint i = 0; i < blockCount; ++i)
+	{
+		glGetProgramResourceName(m_id, GL_UNIFORM_BLOCK, i, static_cast<GLsizei>(name.size()), nullptr, name.data());
+		m_blocks[name.data()] = static_cast<GLuint>(i);
+	}
+}
+
+GLint ShaderProgram::getUniformLocation(const std::string& name) const
+{
+	const auto it = m_locations.find(name);
+	return it != m_locations.end() ? it->second : -1;
+}
+
+GLuint ShaderProgram::getUniformBlockIndex(const std::string& name) const
+{
+	const auto it = m_blocks.find(name);
+	return it != m_blocks.end() ? it->second : GL_INVALID_INDEX;
+}
+
+bool ShaderProgram::update(GLint location, const void* data, std::size_t size)
+{
+	if (location < 0)
+		return false;
+
+	const auto it = m_uniforms.find(location);
+	if (it == m_uniforms.end() || it->second.cacheSize != size)
+		return true;
+
+	Uniform& uniform = it->second;
+	std::uint8_t* cached = m_cache.data() + uniform.cacheOffset;
+	if (uniform.cached && std::memcmp(cached, data, size) == 0)
+		return false;
+
+	std::memcpy(cached, data, size);
+	uniform.cached = true;
+	return true;
+}
+
+void ShaderProgram::setUniform(GLint location, float x)
+{
+	if (update(location, &x, sizeof(x)))
+		glProgramUniform1f(m_id, location, x);
+}
+
+void ShaderProgram::setUniform(GLint location, float x, float y)
+{
+	const float values[] = { x, y };
+	if (update(location, values, sizeof(values)))
+		glProgramUniform2f(m_id, location, x, y);
+}
+
+void ShaderProgram::setUniform(GLint location, float x, float y, float z)
+{
+	const float values[] = { x, y, z };
+	if (update(location, values, sizeof(values)))
+		glProgramUniform3f(m_id, location, x, y, z);
+}
+
+void ShaderProgram::setUniform(GLint location, int x, int y)
+{
+	const GLint values[] = { x, y };
+	if (update(location, values, sizeof(values)))
+		glProgramUniform2i(m_id, location, x, y);
+}
+
+void ShaderProgram::setUniform(GLint location, const Point3d<float>& value)
+{
+	setUniform(location, value.x, value.y, value.z);
+}
+
+void ShaderProgram::setUniform(GLint location, const Mat4<float>& value)
+{
+	if (update(location, value.getData(), 16 * sizeof(float)))
+		glProgramUniformMatrix4fv(m_id, location, 1, GL_FALSE, value.getData());
+}
+
+void ShaderProgram::setUniformArray2(GLint location, const float* values, GLsizei count)
+{
+	if (location >= 0)
+		glProgramUniform2fv(m_id, location, count, values);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "utils/math/Math.h"
+
+// Linked GL program. Its active uniforms and uniform blocks are reflected once, right
+// after linking: locations are looked up here instead of by name in the driver, and
+// the last value set to each non-array uniform is kept so that setting the same value
+// again costs no GL call. Uniforms are set with glProgramUniform*, the program does
+// not need to be bound.
+class ShaderProgram
+{
+public:
+	ShaderProgram() = default;
+
+	// Takes ownership of a linked program
+	explicit ShaderProgram(GLuint id);
+	~ShaderProgram();
+
+	ShaderProgram(ShaderProgram&& other) noexcept;
+	ShaderProgram& operator=(ShaderProgram&& other) noexcept;
+	ShaderProgram(const ShaderProgram&) = delete;
+	ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+	GLuint getId() const { return m_id; }
+	bool isValid() const { return m_id != 0; }
+
+	void use() const { glUseProgram(m_id); }
+
+	// -1 when the program has no such active uniform, which the setters ignore. Array
+	// uniforms answer to their name with or without "[0]".
+	GLint getUniformLocation(const std::string& name) const;
+
+	// GL_INVALID_INDEX when the program has no such active block
+	GLuint getUniformBlockIndex(const std::string& name) const;
+
+	void setUniform(GLint location, float x);
+	void setUniform(GLint location, float x, float y);
+	void setUniform(GLint location, float x, float y, float z);
+	void setUniform(GLint location, int x, int y);
+	void setUniform(GLint location, const Point3d<float>& value);
+	void setUniform(GLint location, const Mat4<float>& value);
+
+	// count vec2 of an array uniform, never cached
+	void setUniformArray2(GLint location, const float* values, GLsizei count);
+
+private:
+	struct Uniform
+	{
+		GLenum type = GL_NONE;
+		GLint arraySize = 1;
+		std::size_t cacheOffset = 0;
+		std::size_t cacheSize = 0;      // bytes, 0 for arrays
+		bool cached = false;
+	};
+
+	void reflect();
+	void release();
+
+	// True when the bytes differ from the ones last set at location, which they replace
+	bool update(GLint location, const void* data, std::size_t size);
+
+	GLuint m_id = 0;
+	std::unordered_map<std::string, GLint> m_locations;
+	std::unordered_map<std::string, GLuint> m_blocks;
+	std::unordered_map<GLint, Uniform> m_uniforms;
+	std::vector<std::uint8_t> m_cache;
+};
@@ -0,0 +1,89 @@
+#version 430 core
+
+// Terrain displaced on the GPU: one patch of ChunkVertices x ChunkVertices vertices,
+// without any vertex attribute, drawn once per chunk. The heights are read from the
+// heightmap texture and the normals derived from it, so that only 2 bytes per sample
+// live in video memory.
+layout (location = 0) in ivec4 vChunk;     // per instance: first sample, stride, LOD level
+
+const int ChunkQuads = 128;
+const int ChunkVertices = ChunkQuads + 1;
+const int MaxLodLevels = 8;
+
+// Camera and light of the frame, shared by every program (FrameUniforms)
+layout (std140, binding = 0) uniform Frame
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	vec4 lightDirection;
+	vec4 lightColor;
+} frame;
+
+uniform mat4 ModelMatrix;
+
+struct Grid
+{
+	vec2 origin;
+	float spacing;
+	ivec2 size;
+	float heightMin;
+	float heightExtent;
+};
+
+uniform Grid grid;
+
+// per level: distance where morphing starts, 1 / length of the morph zone
+uniform vec2 lodMorph[MaxLodLevels];
+
+// heights quantized over [heightMin, heightMin + heightExtent], one texel per sample
+layout (binding = 0) uniform sampler2D heightmap;
+
+out vec3 iWorldNormal;
+out vec3 iWorldPosition;
+
+float heightAt(ivec2 sampleIndex)
+{
+	return grid.heightMin + texelFetch(heightmap, sampleIndex, 0).r * grid.heightExtent;
+}
+
+// sample of the chunk vertex at local, clamped to the grid as packChunkAt does
+ivec2 chunkSample(ivec2 local)
+{
+	return min(vChunk.xy + local * vChunk.z, grid.size - 1);
+}
+
+void main()
+{
+	ivec2 local = ivec2(gl_VertexID % ChunkVertices, gl_VertexID / ChunkVertices);
+	ivec2 sampleIndex = chunkSample(local);
+	float height = heightAt(sampleIndex);
+
+	// height of the coarser level at this vertex: odd vertices sit on the middle of a coarse edge
+	float morphHeight = height;
+	if (local.x % 2 == 1 && local.y % 2 == 1)
+		morphHeight = 0.5 * (heightAt(chunkSample(local + ivec2(-1, 1))) + heightAt(chunkSample(local + ivec2(1, -1))));
+	else if (local.x % 2 == 1)
+		morphHeight = 0.5 * (heightAt(chunkSample(local + ivec2(-1, 0))) + heightAt(chunkSample(local + ivec2(1, 0))));
+	else if (local.y % 2 == 1)
+		morphHeight = 0.5 * (heightAt(chunkSample(local + ivec2(0, -1))) + heightAt(chunkSample(local + ivec2(0, 1))));
+
+	vec4 vPosition = vec4(grid.origin.x + sampleIndex.x * grid.spacing, height, grid.origin.y + sampleIndex.y * grid.spacing, 1.0);
+
+	// slide towards the coarser level at the end of this level's range
+	vec2 morph = lodMorph[vChunk.w];
+	float morphFactor = clamp((distance((ModelMatrix * vPosition).xyz, frame.cameraPosition.xyz) - morph.x) * morph.y, 0.0, 1.0);
+	vPosition.y = mix(height, morphHeight, morphFactor);
+
+	// central differences of the full resolution heights, one-sided on the borders (computeGradientNormals)
+	ivec2 left = max(sampleIndex - ivec2(1, 0), ivec2(0));
+	ivec2 right = min(sampleIndex + ivec2(1, 0), grid.size - 1);
+	ivec2 up = max(sampleIndex - ivec2(0, 1), ivec2(0));
+	ivec2 down = min(sampleIndex + ivec2(0, 1), grid.size - 1);
+	float gx = (heightAt(left) - heightAt(right)) / (max(right.x - left.x, 1) * grid.spacing);
+	float gz = (heightAt(up) - heightAt(down)) / (max(down.y - up.y, 1) * grid.spacing);
+
+	gl_Position = frame.projectionMatrix * frame.viewMatrix * ModelMatrix * vPosition;
+	iWorldNormal = mat3(ModelMatrix) * normalize(vec3(gx, 1.0, gz));
+	iWorldPosition = (ModelMatrix * vPosition).xyz;
+}
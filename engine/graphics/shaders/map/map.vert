@@ -1,21 +1,81 @@
 #version 430 core
 
-layout (location = 0) in vec4 vPosition;
-layout (location = 1) in vec3 vNormal;
-layout (location = 2) in vec4 vColor;
+// Compact terrain vertex: the height, the height of the next coarser LOD level at the
+// same place (both quantized over the terrain height range) and an octahedral normal.
+// x and z come from the vertex position in its chunk of ChunkVertices x ChunkVertices vertices.
+layout (location = 0) in vec2 vHeights;
+layout (location = 1) in vec2 vNormal;
+
+const int ChunkQuads = 128;
+const int ChunkVertices = ChunkQuads + 1;
+const int MaxLodLevels = 8;
+
+// Every slot of ChunkVertices * ChunkVertices vertices holds one chunk of one LOD level
+struct ChunkSlot
+{
+	ivec2 firstSample;
+	int stride;
+	int level;
+};
+
+layout (std430, binding = 0) readonly buffer ChunkSlots
+{
+	ChunkSlot slots[];
+};
+
+// Camera and light of the frame, shared by every program (FrameUniforms)
+layout (std140, binding = 0) uniform Frame
+{
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	vec4 lightDirection;
+	vec4 lightColor;
+} frame;
 
 uniform mat4 ModelMatrix;
-uniform mat4 ViewMatrix;
-uniform mat4 ProjectionMatrix;
 
-out vec4 iColor;
+struct Grid
+{
+	vec2 origin;
+	float spacing;
+	ivec2 size;
+	float heightMin;
+	float heightExtent;
+};
+
+uniform Grid grid;
+
+// per level: distance where morphing starts, 1 / length of the morph zone
+uniform vec2 lodMorph[MaxLodLevels];
+
 out vec3 iWorldNormal;
 out vec3 iWorldPosition;
 
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+	if (n.y < 0.0)
+		n.xz = (1.0 - abs(n.zx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.z >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
 void main()
 {
-	gl_Position = ProjectionMatrix * ViewMatrix * ModelMatrix * vPosition;
-	iColor = vColor;
-	iWorldNormal = mat3(ModelMatrix) * vNormal;
+	ChunkSlot chunk = slots[gl_VertexID / (ChunkVertices * ChunkVertices)];
+	int local = gl_VertexID % (ChunkVertices * ChunkVertices);
+
+	ivec2 sampleIndex = min(chunk.firstSample + ivec2(local % ChunkVertices, local / ChunkVertices) * chunk.stride, grid.size - 1);
+	vec2 heights = grid.heightMin + vHeights * grid.heightExtent;
+
+	vec4 vPosition = vec4(grid.origin.x + sampleIndex.x * grid.spacing, heights.x, grid.origin.y + sampleIndex.y * grid.spacing, 1.0);
+
+	// slide towards the coarser level at the end of this level's range
+	vec2 morph = lodMorph[chunk.level];
+	float morphFactor = clamp((distance((ModelMatrix * vPosition).xyz, frame.cameraPosition.xyz) - morph.x) * morph.y, 0.0, 1.0);
+	vPosition.y = mix(heights.x, heights.y, morphFactor);
+
+	gl_Position = frame.projectionMatrix * frame.viewMatrix * ModelMatrix * vPosition;
+	iWorldNormal = mat3(ModelMatrix) * octDecode(vNormal);
 	iWorldPosition = (ModelMatrix * vPosition).xyz;
-}
\ No newline at end of file
+}
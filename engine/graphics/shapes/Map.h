@@ -3,24 +3,34 @@
 #include "GL/glew.h"
 #include "SFML/OpenGL.hpp"
 
+#include <algorithm>
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
 #include <iostream>
+#include <string>
+#include <vector>
 
+#include "utils/math/Frustum.h"
 #include "utils/math/Math.h"
+#include "utils/math/Noise.h"
+#include "utils/math/RuntimeNoise.h"
+#include "utils/threading/ThreadPool.h"
+#include "engine/graphics/shaders/Material.h"
 #include "engine/graphics/shaders/Shader.h"
-
-
-template<typename Type>
-struct vertex_struct_map
-{
-	vertex_struct_map(const Point3d<Type>& p_, const Point3d<Type>& n_, const Color<Type>& c_) : p(p_), c(c_), n(n_) {}
-	Point3d<Type> p;
-	Point3d<Type> n;
-
-	Color<Type> c;
-	int nb_face = 0;
-
-};
+#include "engine/graphics/shaders/ShaderProgram.h"
+#include "engine/profiling/Profiler.h"
+#include "engine/terrain/ChunkGrid.h"
+#include "engine/terrain/Heightfield.h"
+#include "engine/terrain/HeightGenerator.h"
+#include "engine/terrain/HydraulicErosion.h"
+#include "engine/terrain/LodQuadtree.h"
+#include "engine/terrain/NormalGenerator.h"
+#include "engine/terrain/Sculpt.h"
+#include "engine/terrain/TerrainVertex.h"
+#include "engine/terrain/ThermalErosion.h"
+#include "engine/terrain/Tiling.h"
 
 
 template<typename Type>
@@ -28,10 +38,32 @@ class Map
 {
 public:
 
-	Map()
+	// How the terrain reaches the GPU. Chunks: every chunk slot of every LOD level packed
+	// in one vertex buffer (TerrainVertex, 8 bytes per vertex and slot), from normals
+	// kept on the CPU. Heightmap, the default: the heights as one R16 texture (2 bytes
+	// per sample) displacing a single shared grid patch, drawn instanced once per
+	// selected chunk (heightmap.vert), with no mesh built on the CPU.
+	enum class RenderPath
+	{
+		Chunks,
+		Heightmap
+	};
+
+	// presetPath: noise graph of the heights, see RuntimeNoise.h. FractalNoise when it
+	// can't be read. erosion: the droplets run over the new heights, one batch per
+	// update() so loading never waits for them; a dropletCount of 0 turns it off.
+	explicit Map(const std::string& presetPath = DefaultPreset, RenderPath renderPath = RenderPath::Heightmap, const terrain::ErosionSettings& erosion = terrain::ErosionSettings())
 		: m_vao(0)
 		, m_vbo(0)
+		, m_renderPath(renderPath)
+		, m_erosion(erosion)
 	{
+		try {
+			m_noiseGraph = noise::RuntimeGraph::load(presetPath);
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << ", using the default noise" << std::endl;
+		}
 		load();
 	}
 
@@ -39,49 +71,72 @@ public:
 	{
 		glDeleteVertexArrays(1, &m_vao);
 		glDeleteBuffers(1, &m_vbo);
+		glDeleteBuffers(1, &m_elementbuffer);
+		glDeleteBuffers(1, &m_slotBuffer);
+		glDeleteVertexArrays(1, &m_patchVao);
+		glDeleteBuffers(1, &m_instanceBuffer);
+		glDeleteTextures(1, &m_heightmapTexture);
 	}
 
 
 	void generateTerrainVerticesIndices(float size, float step) {
 
 		int numVertices = static_cast<int>(size / step) + 1;
-		int height = -1;
 
-		for (int i = 0; i < numVertices; i++) {
-			for (int j = 0; j < numVertices; j++) {
-				Type x = i * step;
-				Type z = j * step;
-				Type y = height;
-				m_vertexVect.push_back(Point3d<Type>{x, y, z});
+		m_heightfield = Heightfield<Type>(numVertices, numVertices, step);
+		if (m_noiseGraph.isEmpty())
+			terrain::generateHeights(m_heightfield, m_noise, m_baseHeight);
+		else
+			terrain::generateHeights(m_heightfield, m_noiseGraph, m_baseHeight);
 
-			}
-		}
+		m_erosion.reset();
 
-		// Gnrer les indices pour les triangles
-		for (int i = 0; i < numVertices - 1; i++) {
-			for (int j = 0; j < numVertices - 1; j++) {
-				// Indices des sommets des deux triangles formant un carr
-				unsigned int index1 = i * numVertices + j;
-				unsigned int index2 = index1 + 1;
-				unsigned int index3 = (i + 1) * numVertices + j;
-				unsigned int index4 = index3 + 1;
-
-				// Premier triangle
-				m_indices.push_back(index1);
-				m_indices.push_back(index2);
-				m_indices.push_back(index3);
-
-				// Deuxime triangle
-				m_indices.push_back(index2);
-				m_indices.push_back(index4);
-				m_indices.push_back(index3);
-			}
-		}
+		// Une seule bande de triangles par range de quads, partage par tous les chunks
+		m_lod.build(m_heightfield, m_lodSettings);
+		m_stripIndices = terrain::buildStripIndices(terrain::ChunkVertices);
 	}
 
 	void load()
 	{
+		generateTerrainVerticesIndices(20, 0.01);
+		m_heightQuantizer = terrain::computeHeightRange(m_heightfield);
+
+		// the strip indices of one chunk, bound to the VAO of both render paths
+		glGenBuffers(1, &m_elementbuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, m_elementbuffer);
+		glBufferData(GL_ARRAY_BUFFER, m_stripIndices.size() * sizeof(std::uint16_t), m_stripIndices.data(), GL_STATIC_DRAW);
+
+		if (m_renderPath == RenderPath::Chunks)
+			loadChunks();
+		else
+			loadHeightmap();
+	}
+
+	RenderPath getRenderPath() const
+	{
+		return m_renderPath;
+	}
+
+	// Builds the resources of the new path from the current heights and frees those of
+	// the other one, so that only one copy of the terrain stays in memory
+	void setRenderPath(RenderPath renderPath)
+	{
+		if (renderPath == m_renderPath)
+			return;
+
+		m_renderPath = renderPath;
+		if (m_renderPath == RenderPath::Chunks) {
+			unloadHeightmap();
+			loadChunks();
+		}
+		else {
+			unloadChunks();
+			loadHeightmap();
+		}
+	}
 
+	void loadChunks()
+	{
 		// We want only one buffer with the id generated and stored in m_vao
 		glGenVertexArrays(1, &m_vao);
 
@@ -96,132 +151,484 @@ public:
 		// 3. if binded to 0, OpenGL stops
 		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
 
-		Color<Type> Green = { 0, 1, 0, 1 };
-		Point3d<Type> YNormal = { 0, +1, 0 };
+		using VertexType = terrain::TerrainVertex;
 
-		using VertexStructMapType = vertex_struct_map<Type>;
-		std::vector<vertex_struct_map<Type>> points;
+		terrain::computeGradientNormals(m_heightfield);
 
-		generateTerrainVerticesIndices(20, 0.01);
+		// one slot of ChunkVertexCount vertices per chunk of every LOD level
+		const int slotCount = m_lod.getSlotCount();
+		m_nbVertices = static_cast<GLsizei>(slotCount * terrain::ChunkVertexCount);
 
-		for (Point3d<float>& p : m_vertexVect)
-		{
-			points.push_back(VertexStructMapType{ p, YNormal, Green });
-		}
+		// Allocate storage size units of OpenGL, then pack the vertices straight
+		// from the heightfield into the mapped buffer, chunk after chunk
+		const GLsizeiptr bufferSize = m_nbVertices * sizeof(VertexType);
+		glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_STATIC_DRAW);
+		auto* points = static_cast<VertexType*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
 
-		for (int i = 2; i < m_indices.size(); i += 3) {
-			int index = m_indices.at(i);
-			VertexStructMapType& p1 = points.at(m_indices.at(i));
-			VertexStructMapType& p2 = points.at(m_indices.at(i - 1));
-			VertexStructMapType& p3 = points.at(m_indices.at(i - 2));
+		utils::ThreadPoolInstance::GetInstance()->parallelFor(0, slotCount, 1, [&](size_t first, size_t last) {
+			for (int slot = static_cast<int>(first); slot < static_cast<int>(last); slot++)
+				packSlot(slot, points + static_cast<size_t>(slot) * terrain::ChunkVertexCount);
+		});
 
-			//calculate vector
-			Point3d<Type> vec12 = { p2.p.x - p1.p.x, p2.p.y - p1.p.y, p2.p.z - p1.p.z };
-			Point3d<Type> vec13 = { p3.p.x - p1.p.x, p3.p.y - p1.p.y, p3.p.z - p1.p.z };
+		glUnmapBuffer(GL_ARRAY_BUFFER);
 
-			//Calculate normal
-			Point3d<Type> normal =
-			{
-				(vec12.z * vec13.y) - (vec12.y * vec13.z),
-				(vec12.x * vec13.z) - (vec12.z * vec13.x),
-				(vec12.y * vec13.x) - (vec12.x * vec13.y)
-			};
-
-			p1.n = ((p1.n * p1.nb_face) + normal) / (p1.nb_face + 1);
-			p1.n = p1.n / std::sqrt((p1.n.x * p1.n.x) + (p1.n.y * p1.n.y) + (p1.n.z * p1.n.z));
+		// where each slot sits in the heightfield, read by map.vert through gl_VertexID
+		struct ChunkSlotData
+		{
+			GLint firstSample[2];
+			GLint stride;
+			GLint level;
+		};
 
-			p1.nb_face += 1;
+		std::vector<ChunkSlotData> slots(slotCount);
+		for (int slot = 0; slot < slotCount; slot++) {
+			const int level = m_lod.getSlotLevel(slot);
+			slots[slot] = { { m_lod.getSlotFirstColumn(slot), m_lod.getSlotFirstRow(slot) }, m_lod.getLevel(level).stride, level };
+		}
 
-			p2.n = ((p2.n * p2.nb_face) + normal) / (p2.nb_face + 1);
-			p2.n = p2.n / std::sqrt((p2.n.x * p2.n.x) + (p2.n.y * p2.n.y) + (p2.n.z * p2.n.z));
+		glGenBuffers(1, &m_slotBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_slotBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, slots.size() * sizeof(ChunkSlotData), slots.data(), GL_STATIC_DRAW);
 
-			p2.nb_face += 1;
+		ShaderInfo shaders[] = {
+			{GL_VERTEX_SHADER, "assets/shaders/map.vert"},
+			{GL_FRAGMENT_SHADER, "assets/shaders/map.frag"},
+			{GL_NONE, nullptr}
+		};
 
-			p3.n = ((p3.n * p3.nb_face) + normal) / (p3.nb_face + 1);
-			p3.n = p3.n / std::sqrt((p3.n.x * p3.n.x) + (p3.n.y * p3.n.y) + (p3.n.z * p3.n.z));
+		m_program = Shader::loadShaders(shaders);
+		m_program.use();
+		m_modelMatrixLocation = m_program.getUniformLocation("ModelMatrix");
+		m_materialUniforms = MaterialUniforms(m_program);
 
-			p3.nb_face += 1;
+		// height and morph height as normalized unsigned shorts, then the octahedral normal as two normalized shorts
+		glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(VertexType), (char*)(0) + offsetof(VertexType, height));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(VertexType), (char*)(0) + offsetof(VertexType, normal));
+		glEnableVertexAttribArray(1);
 
-		}
+		// x and z are rebuilt in map.vert from the vertex index and the grid layout
+		setGridUniforms(m_program);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementbuffer);
+	}
 
-		m_nbVertices = static_cast<GLsizei>(points.size());
+	void loadHeightmap()
+	{
+		const int width = m_heightfield.getWidth();
+		const int height = m_heightfield.getHeight();
+
+		// texelFetch only, but without mipmaps the texture must not ask for them to be complete
+		glGenTextures(1, &m_heightmapTexture);
+		glBindTexture(GL_TEXTURE_2D, m_heightmapTexture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_R16, width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		uploadHeights({ 0, width, 0, height });
+
+		// the patch has no vertex buffer: heightmap.vert places its vertices from gl_VertexID
+		glGenVertexArrays(1, &m_patchVao);
+		glBindVertexArray(m_patchVao);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementbuffer);
 
-		// Allocate storage size units of OpenGL
-		// Copy data from client to server
-		glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(VertexStructMapType), points.data(), GL_STATIC_DRAW);
+		// one instance per selected chunk: first sample, stride and LOD level
+		glGenBuffers(1, &m_instanceBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+		glVertexAttribIPointer(0, 4, GL_INT, 4 * sizeof(GLint), nullptr);
+		glVertexAttribDivisor(0, 1);
+		glEnableVertexAttribArray(0);
 
 		ShaderInfo shaders[] = {
-			{GL_VERTEX_SHADER, "assets/shaders/map.vert"},
+			{GL_VERTEX_SHADER, "assets/shaders/heightmap.vert"},
 			{GL_FRAGMENT_SHADER, "assets/shaders/map.frag"},
 			{GL_NONE, nullptr}
 		};
 
-		m_program = Shader::loadShaders(shaders);
-		glUseProgram(m_program);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexStructMapType), 0);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexStructMapType), (char*)(0) + sizeof(VertexStructMapType::p));
-		glEnableVertexAttribArray(1);
+		m_heightmapProgram = Shader::loadShaders(shaders);
+		m_heightmapProgram.use();
+		m_heightmapModelMatrixLocation = m_heightmapProgram.getUniformLocation("ModelMatrix");
+		m_heightmapMaterialUniforms = MaterialUniforms(m_heightmapProgram);
+		setGridUniforms(m_heightmapProgram);
+	}
 
-		// En cas de bug penser a changer le dcalage par rapport au autres donnes dans la struct
-		glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(VertexStructMapType), (char*)(0) + sizeof(VertexStructMapType::p) + sizeof(VertexStructMapType::n));
-		glEnableVertexAttribArray(2);
+	// Frees the vertex and slot buffers, the program and the normal planes
+	void unloadChunks()
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		glDeleteBuffers(1, &m_vbo);
+		glDeleteBuffers(1, &m_slotBuffer);
+		m_vao = 0;
+		m_vbo = 0;
+		m_slotBuffer = 0;
+		m_nbVertices = 0;
+		m_program = ShaderProgram();
+		m_heightfield.releaseNormals();
+		std::vector<terrain::TerrainVertex>().swap(m_refreshVertices);
+	}
 
+	// Frees the texture, the patch VAO, the instance buffer and the program
+	void unloadHeightmap()
+	{
+		glDeleteTextures(1, &m_heightmapTexture);
+		glDeleteVertexArrays(1, &m_patchVao);
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_heightmapTexture = 0;
+		m_patchVao = 0;
+		m_instanceBuffer = 0;
+		m_heightmapProgram = ShaderProgram();
+		std::vector<std::uint16_t>().swap(m_heightmapTexels);
+	}
 
+	const Heightfield<Type>& getHeightfield() const
+	{
+		return m_heightfield;
+	}
 
-		glGenBuffers(1, &m_elementbuffer);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementbuffer);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int), &m_indices[0], GL_STATIC_DRAW);
+	const terrain::LodQuadtree& getLod() const
+	{
+		return m_lod;
 	}
 
-	void render(const Mat4<Type>& View, const Mat4<Type>& Projection)
+	Mat4<Type> getModelMatrix() const
 	{
-		glBindVertexArray(m_vao);
+		return Mat4<Type>::translation(0, 0, -5) * Mat4<Type>::rotationY(m_angleY) * Mat4<Type>::rotationX(m_angleX);
+	}
 
-		Mat4<Type> Model = Mat4<Type>::translation(0, 0, -5) * Mat4<Type>::rotationY(m_angleY) * Mat4<Type>::rotationX(m_angleX);
+	// World position expressed in the map space, where the heightfield lives
+	Point3d<Type> toMapSpace(const Point3d<Type>& worldPosition) const
+	{
+		const Mat4<Type> model = getModelMatrix();
+		const Point3d<Type> d = worldPosition - Point3d<Type>(model(0, 3), model(1, 3), model(2, 3));
+
+		// the model matrix is a rotation then a translation: its inverse uses the transposed rotation
+		return {
+			model(0, 0) * d.x + model(1, 0) * d.y + model(2, 0) * d.z,
+			model(0, 1) * d.x + model(1, 1) * d.y + model(2, 1) * d.z,
+			model(0, 2) * d.x + model(1, 2) * d.y + model(2, 2) * d.z
+		};
+	}
 
-		glUniformMatrix4fv(glGetUniformLocation(m_program, "ModelMatrix"), 1, GL_FALSE, Model.getData());
-		glUniformMatrix4fv(glGetUniformLocation(m_program, "ViewMatrix"), 1, GL_FALSE, View.getData());
-		glUniformMatrix4fv(glGetUniformLocation(m_program, "ProjectionMatrix"), 1, GL_FALSE, Projection.getData());
+	// Number of chunks drawn by the last render
+	int getDrawnChunkCount() const
+	{
+		return static_cast<int>(m_selectedSlots.size());
+	}
 
-		glUniform1f(glGetUniformLocation(m_program, "material.ambient"), 0.3f);
-		glUniform1f(glGetUniformLocation(m_program, "material.diffuse"), 0.7f);
-		glUniform1f(glGetUniformLocation(m_program, "material.specular"), 1.f);
-		glUniform1f(glGetUniformLocation(m_program, "material.specularSmoothness"), 2.0f);
+	// Number of chunks left out of the last render by the frustum
+	int getCulledChunkCount() const
+	{
+		return m_lod.getCulledCount();
+	}
+
+	void render(const Mat4<Type>& View, const Mat4<Type>& Projection, const Point3d<Type>& CameraPosition)
+	{
+		const bool heightmap = m_renderPath == RenderPath::Heightmap;
+		ShaderProgram& program = heightmap ? m_heightmapProgram : m_program;
+		glBindVertexArray(heightmap ? m_patchVao : m_vao);
+		program.use();
 
-		glUniform3f(glGetUniformLocation(m_program, "light.direction"), 0.f, -1.f, 0.f);
-		glUniform3f(glGetUniformLocation(m_program, "light.color"), 1.f, 1.f, 1.f);
+		Mat4<Type> Model = getModelMatrix();
+
+		// view, projection, camera and light come from the frame uniform buffer
+		program.setUniform(heightmap ? m_heightmapModelMatrixLocation : m_modelMatrixLocation, Model);
+		(heightmap ? m_heightmapMaterialUniforms : m_materialUniforms).apply(program, m_material);
+
+		// pick the LOD of every part of the map in view, then one draw per selected chunk
+		{
+			PROFILE_SCOPE("lod select");
+			const Frustum frustum = Frustum::fromMatrix(Projection * View * Model);
+			m_lod.select(toMapSpace(CameraPosition), frustum, m_selectedSlots);
+		}
+		PROFILE_COUNTER("drawn chunks", m_lod.getVisibleCount());
+		PROFILE_COUNTER("culled chunks", m_lod.getCulledCount());
 
-		glUniform3f(glGetUniformLocation(m_program, "camera.worldPosition"), 0.f, 0.f, 0.f);
+		if (heightmap) {
+			renderHeightmap();
+			return;
+		}
 
+		const size_t drawCount = m_selectedSlots.size();
+		m_drawCounts.assign(drawCount, static_cast<GLsizei>(m_stripIndices.size()));
+		m_drawOffsets.assign(drawCount, nullptr);
+		m_drawBaseVertices.resize(drawCount);
+		for (size_t draw = 0; draw < drawCount; draw++)
+			m_drawBaseVertices[draw] = static_cast<GLint>(m_selectedSlots[draw] * terrain::ChunkVertexCount);
 
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_slotBuffer);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementbuffer);
 
-		glDrawElements(
-			GL_TRIANGLES,      // mode
-			m_indices.size(),    // count
-			GL_UNSIGNED_INT,   // type
-			(void*)0           // element array buffer offset
+		// 0xFFFF ends a strip: with 16-bit indices it is the fixed restart index
+		glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+
+		glMultiDrawElementsBaseVertex(
+			GL_TRIANGLE_STRIP,          // mode
+			m_drawCounts.data(),        // count per chunk
+			GL_UNSIGNED_SHORT,          // type
+			m_drawOffsets.data(),       // element array buffer offset per chunk
+			static_cast<GLsizei>(drawCount),
+			m_drawBaseVertices.data()   // first vertex of each chunk
 		);
 
+		glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+	}
+
+	// The selected chunks as instances of the shared patch, in a single draw
+	void renderHeightmap()
+	{
+		const size_t drawCount = m_selectedSlots.size();
+		m_instances.resize(drawCount * 4);
+		for (size_t draw = 0; draw < drawCount; draw++) {
+			const int slot = m_selectedSlots[draw];
+			GLint* instance = m_instances.data() + draw * 4;
+			instance[0] = m_lod.getSlotFirstColumn(slot);
+			instance[1] = m_lod.getSlotFirstRow(slot);
+			instance[2] = m_lod.getLevel(m_lod.getSlotLevel(slot)).stride;
+			instance[3] = m_lod.getSlotLevel(slot);
+		}
+
+		// orphaned every frame, the previous draw may still read it
+		glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+		glBufferData(GL_ARRAY_BUFFER, m_instances.size() * sizeof(GLint), m_instances.data(), GL_STREAM_DRAW);
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, m_heightmapTexture);
+
+		glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+		glDrawElementsInstanced(GL_TRIANGLE_STRIP, static_cast<GLsizei>(m_stripIndices.size()), GL_UNSIGNED_SHORT, nullptr, static_cast<GLsizei>(drawCount));
+		glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
 	}
 
 	void update()
 	{
 		/*m_angleX += 0.0125f;
 		m_angleY += 0.025f;*/
+
+		// droplets land anywhere on the map: the whole field changes with each batch
+		if (!m_erosion.isFinished()) {
+			m_erosion.erode(m_heightfield, 1);
+
+			const terrain::TileRect field{ 0, m_heightfield.getWidth(), 0, m_heightfield.getHeight() };
+			m_thermal.invalidate(field);
+			addDirtyRegion(field);
+		}
+
+		// everything edited since the last update, once
+		refreshRegions(m_dirtyRegions);
+		m_dirtyRegions.clear();
+	}
+
+	// Runs iterations steps of thermal erosion; the changed tiles are refreshed by update()
+	void erodeThermal(int iterations)
+	{
+		m_thermal.run(m_heightfield, iterations);
+		for (const terrain::TileRect& tile : m_thermal.getDirtyTiles())
+			addDirtyRegion(tile);
+		m_thermal.clearDirtyTiles();
+	}
+
+	// Where the ray from worldOrigin along worldDirection first hits the terrain, in map space
+	bool pick(const Point3d<Type>& worldOrigin, const Point3d<Type>& worldDirection, Point3d<Type>& mapHit) const
+	{
+		const Point3d<Type> origin = toMapSpace(worldOrigin);
+		const Point3d<Type> direction = toMapSpace(worldOrigin + worldDirection) - origin;
+		return terrain::raycast(m_heightfield, origin, direction, PickDistance, mapHit);
+	}
+
+	// Applies brush around mapPoint (see pick) for deltaTime seconds. Only the brush
+	// footprint is refreshed, by the next update().
+	void sculpt(const terrain::Brush& brush, const Point3d<Type>& mapPoint, float deltaTime)
+	{
+		const terrain::TileRect changed = terrain::applyBrush(m_heightfield, brush, mapPoint.x, mapPoint.z, deltaTime);
+		if (changed.isEmpty())
+			return;
+
+		m_thermal.invalidate(changed);
+		addDirtyRegion(changed);
+	}
+
+	// Queues region for the next update(), merged with the queued regions it overlaps
+	void addDirtyRegion(terrain::TileRect region)
+	{
+		for (size_t i = 0; i < m_dirtyRegions.size();) {
+			const terrain::TileRect& other = m_dirtyRegions[i];
+			if (!other.overlaps(region)) {
+				i++;
+				continue;
+			}
+
+			region = { std::min(region.columnBegin, other.columnBegin), std::max(region.columnEnd, other.columnEnd), std::min(region.rowBegin, other.rowBegin), std::max(region.rowEnd, other.rowEnd) };
+			m_dirtyRegions.erase(m_dirtyRegions.begin() + i);
+			i = 0;
+		}
+		m_dirtyRegions.push_back(region);
+	}
+
+	// The heights of regions were edited: re-derives the bounds of the chunks over them
+	// and re-uploads what the loaded render paths keep of them only, the normals and
+	// vertices of those chunk slots, the texels of the heightmap
+	void refreshRegions(const std::vector<terrain::TileRect>& regions)
+	{
+		if (regions.empty())
+			return;
+
+		const int width = m_heightfield.getWidth();
+		const int height = m_heightfield.getHeight();
+
+		// gradient normals read one sample around; regions may touch, so rows split the work
+		float minimum = m_heightQuantizer.minimum;
+		float maximum = m_heightQuantizer.minimum + m_heightQuantizer.extent;
+		std::vector<terrain::TileRect> touched;
+		for (const terrain::TileRect& region : regions) {
+			const terrain::TileRect normals = region.expanded(1, width, height);
+			if (m_vao != 0) {
+				utils::ThreadPoolInstance::GetInstance()->parallelFor(normals.rowBegin, normals.rowEnd, 16, [&](size_t first, size_t last) {
+					terrain::computeGradientNormalTile(m_heightfield, normals.columnBegin, normals.columnEnd, static_cast<int>(first), static_cast<int>(last));
+				});
+			}
+
+			for (int row = region.rowBegin; row < region.rowEnd; row++) {
+				const auto [low, high] = std::minmax_element(m_heightfield.getRow(row) + region.columnBegin, m_heightfield.getRow(row) + region.columnEnd);
+				minimum = std::min(minimum, *low);
+				maximum = std::max(maximum, *high);
+			}
+
+			m_lod.updateBounds(m_heightfield, normals);
+			touched.push_back(normals);
+		}
+
+		// heights out of the quantized range: every vertex has to be encoded again
+		const bool requantize = minimum < m_heightQuantizer.minimum || maximum > m_heightQuantizer.minimum + m_heightQuantizer.extent;
+		if (requantize) {
+			// with some headroom, so that a brush stroke does not re-encode the map every frame
+			m_heightQuantizer = terrain::computeHeightRange(m_heightfield);
+			m_heightQuantizer.minimum -= m_heightQuantizer.extent * 0.125f;
+			m_heightQuantizer.extent *= 1.25f;
+			for (ShaderProgram* program : { &m_program, &m_heightmapProgram }) {
+				program->setUniform(program->getUniformLocation("grid.heightMin"), m_heightQuantizer.minimum);
+				program->setUniform(program->getUniformLocation("grid.heightExtent"), m_heightQuantizer.extent);
+			}
+		}
+
+		if (m_heightmapTexture != 0) {
+			if (requantize)
+				uploadHeights({ 0, width, 0, height });
+			else
+				for (const terrain::TileRect& region : regions)
+					uploadHeights(region);
+		}
+
+		if (m_vao == 0)
+			return;
+
+		m_refreshSlots.clear();
+		for (int slot = 0; slot < m_lod.getSlotCount(); slot++) {
+			const terrain::TileRect rect = m_lod.getSlotRect(slot);
+			if (requantize || std::any_of(touched.begin(), touched.end(), [&](const terrain::TileRect& region) { return region.overlaps(rect); }))
+				m_refreshSlots.push_back(slot);
+		}
+
+		m_refreshVertices.resize(m_refreshSlots.size() * terrain::ChunkVertexCount);
+		utils::ThreadPoolInstance::GetInstance()->parallelFor(0, m_refreshSlots.size(), 1, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++)
+				packSlot(m_refreshSlots[i], m_refreshVertices.data() + i * terrain::ChunkVertexCount);
+		});
+
+		const GLsizeiptr chunkBytes = terrain::ChunkVertexCount * sizeof(terrain::TerrainVertex);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		for (size_t i = 0; i < m_refreshSlots.size(); i++)
+			glBufferSubData(GL_ARRAY_BUFFER, m_refreshSlots[i] * chunkBytes, chunkBytes, m_refreshVertices.data() + i * terrain::ChunkVertexCount);
 	}
 
 private:
+	// Grid layout, height range and LOD morphing, the uniforms both vertex shaders share
+	void setGridUniforms(ShaderProgram& program)
+	{
+		program.setUniform(program.getUniformLocation("grid.origin"), m_heightfield.getOriginX(), m_heightfield.getOriginZ());
+		program.setUniform(program.getUniformLocation("grid.spacing"), m_heightfield.getSpacing());
+		program.setUniform(program.getUniformLocation("grid.size"), m_heightfield.getWidth(), m_heightfield.getHeight());
+		program.setUniform(program.getUniformLocation("grid.heightMin"), m_heightQuantizer.minimum);
+		program.setUniform(program.getUniformLocation("grid.heightExtent"), m_heightQuantizer.extent);
+
+		std::array<GLfloat, terrain::MaxLodLevels * 2> lodMorph = {};
+		for (int level = 0; level < m_lod.getLevelCount(); level++) {
+			const auto& lod = m_lod.getLevel(level);
+			const bool morphs = level + 1 < m_lod.getLevelCount();
+			lodMorph[level * 2] = lod.morphStart;
+			lodMorph[level * 2 + 1] = morphs ? 1.f / (lod.range - lod.morphStart) : 0.f;
+		}
+		program.setUniformArray2(program.getUniformLocation("lodMorph"), lodMorph.data(), terrain::MaxLodLevels);
+	}
+
+	// Quantizes the heights of rect into the heightmap texture
+	void uploadHeights(const terrain::TileRect& rect)
+	{
+		const int rectWidth = rect.columnEnd - rect.columnBegin;
+		m_heightmapTexels.resize(static_cast<size_t>(rectWidth) * (rect.rowEnd - rect.rowBegin));
+		utils::ThreadPoolInstance::GetInstance()->parallelFor(rect.rowBegin, rect.rowEnd, 64, [&](size_t first, size_t last) {
+			for (int row = static_cast<int>(first); row < static_cast<int>(last); row++) {
+				const Type* heights = m_heightfield.getRow(row) + rect.columnBegin;
+				std::uint16_t* texels = m_heightmapTexels.data() + static_cast<size_t>(row - rect.rowBegin) * rectWidth;
+				for (int column = 0; column < rectWidth; column++)
+					texels[column] = m_heightQuantizer.quantize(heights[column]);
+			}
+		});
+
+		// rows of 16-bit texels are only 2-byte aligned
+		glBindTexture(GL_TEXTURE_2D, m_heightmapTexture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, rect.columnBegin, rect.rowBegin, rectWidth, rect.rowEnd - rect.rowBegin, GL_RED, GL_UNSIGNED_SHORT, m_heightmapTexels.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+
+	void packSlot(int slot, terrain::TerrainVertex* out) const
+	{
+		const auto& level = m_lod.getLevel(m_lod.getSlotLevel(slot));
+		terrain::packChunk(m_heightfield, level.grid, m_lod.getSlotChunk(slot), level.stride, m_heightQuantizer, out);
+	}
+
+	// farthest terrain pick, in map units
+	static constexpr Type PickDistance = 50;
+
+	static constexpr const char* DefaultPreset = "assets/presets/terrain.noise";
+
 	Type m_angleX = 0;
 	Type m_angleY = 0;
 	GLuint m_vao;
 	GLuint m_vbo;
-	GLuint m_program;
+	RenderPath m_renderPath;
+	ShaderProgram m_program;
+	GLint m_modelMatrixLocation = -1;
+	Material m_material;
+	MaterialUniforms m_materialUniforms;
 	GLsizei m_nbVertices;
 
-	GLuint m_elementbuffer;
-	std::vector<Point3d<Type>> m_vertexVect;
-	std::vector<unsigned int> m_indices;
+	GLuint m_elementbuffer = 0;
+	GLuint m_patchVao = 0;
+	GLuint m_instanceBuffer = 0;
+	GLuint m_heightmapTexture = 0;
+	ShaderProgram m_heightmapProgram;
+	GLint m_heightmapModelMatrixLocation = -1;
+	MaterialUniforms m_heightmapMaterialUniforms;
+	std::vector<GLint> m_instances;
+	std::vector<std::uint16_t> m_heightmapTexels;
+	FractalNoise m_noise;
+	noise::RuntimeGraph m_noiseGraph;
+	Type m_baseHeight = -1;
+	Heightfield<Type> m_heightfield;
+	terrain::HydraulicErosion m_erosion;
+	terrain::ThermalErosion m_thermal;
+	std::vector<terrain::TileRect> m_dirtyRegions;
+	std::vector<int> m_refreshSlots;
+	std::vector<terrain::TerrainVertex> m_refreshVertices;
+	GLuint m_slotBuffer = 0;
+	terrain::HeightQuantizer m_heightQuantizer;
+	terrain::LodSettings m_lodSettings;
+	terrain::LodQuadtree m_lod;
+	std::vector<int> m_selectedSlots;
+	std::vector<std::uint16_t> m_stripIndices;
+	std::vector<GLsizei> m_drawCounts;
+	std::vector<const void*> m_drawOffsets;
+	std::vector<GLint> m_drawBaseVertices;
 };
 
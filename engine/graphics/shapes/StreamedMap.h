@@ -0,0 +1,191 @@
+#pragma once
+
+#include "GL/glew.h"
+#include "SFML/OpenGL.hpp"
+
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "utils/math/Frustum.h"
+#include "utils/math/Math.h"
+#include "utils/math/Noise.h"
+#include "engine/graphics/buffers/UploadService.h"
+#include "engine/graphics/shaders/Material.h"
+#include "engine/graphics/shaders/Shader.h"
+#include "engine/graphics/shaders/ShaderProgram.h"
+#include "engine/profiling/Profiler.h"
+#include "engine/terrain/ChunkGrid.h"
+#include "engine/terrain/ChunkManager.h"
+#include "engine/terrain/TerrainVertex.h"
+
+
+// Unbounded terrain streamed around the camera by a terrain::ChunkManager. Draws with
+// the map shaders: one vertex buffer of getSlotCapacity() chunk slots, the slot table
+// in a shader storage buffer, and the shared strip index buffer. Chunk vertices reach
+// their slot through the UploadService, within its frame budget.
+template<typename Type>
+class StreamedMap
+{
+public:
+
+	explicit StreamedMap(const terrain::StreamingSettings& settings = terrain::StreamingSettings())
+		: m_manager(m_noise, settings)
+	{
+		load();
+	}
+
+	~StreamedMap()
+	{
+		// the worker may still be copying into the vertex buffer
+		UploadServiceInstance::GetInstance()->finish();
+
+		glDeleteVertexArrays(1, &m_vao);
+		glDeleteBuffers(1, &m_vbo);
+		glDeleteBuffers(1, &m_slotBuffer);
+		glDeleteBuffers(1, &m_elementbuffer);
+	}
+
+	void load()
+	{
+		using VertexType = terrain::TerrainVertex;
+
+		glGenVertexArrays(1, &m_vao);
+		glBindVertexArray(m_vao);
+
+		// storage for every slot up front: uploads only ever write into it
+		glGenBuffers(1, &m_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(m_manager.getSlotCapacity()) * terrain::ChunkVertexCount * sizeof(VertexType), nullptr, GL_DYNAMIC_DRAW);
+
+		glGenBuffers(1, &m_slotBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_slotBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(m_manager.getSlotCapacity()) * sizeof(terrain::ChunkSlotInfo), nullptr, GL_DYNAMIC_DRAW);
+
+		ShaderInfo shaders[] = {
+			{GL_VERTEX_SHADER, "assets/shaders/map.vert"},
+			{GL_FRAGMENT_SHADER, "assets/shaders/map.frag"},
+			{GL_NONE, nullptr}
+		};
+
+		m_program = Shader::loadShaders(shaders);
+		m_program.use();
+		m_modelMatrixLocation = m_program.getUniformLocation("ModelMatrix");
+		m_materialUniforms = MaterialUniforms(m_program);
+
+		glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(VertexType), (char*)(0) + offsetof(VertexType, height));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(VertexType), (char*)(0) + offsetof(VertexType, normal));
+		glEnableVertexAttribArray(1);
+
+		// the grid has no edge: sample indices are never clamped
+		const terrain::HeightQuantizer& quantizer = m_manager.getQuantizer();
+		m_program.setUniform(m_program.getUniformLocation("grid.origin"), 0.f, 0.f);
+		m_program.setUniform(m_program.getUniformLocation("grid.spacing"), m_manager.getSettings().spacing);
+		m_program.setUniform(m_program.getUniformLocation("grid.size"), INT_MAX, INT_MAX);
+		m_program.setUniform(m_program.getUniformLocation("grid.heightMin"), quantizer.minimum);
+		m_program.setUniform(m_program.getUniformLocation("grid.heightExtent"), quantizer.extent);
+
+		std::array<GLfloat, terrain::MaxLodLevels * 2> lodMorph = {};
+		for (int level = 0; level < m_manager.getLevelCount(); level++) {
+			const bool morphs = level + 1 < m_manager.getLevelCount();
+			lodMorph[level * 2] = m_manager.getMorphStart(level);
+			lodMorph[level * 2 + 1] = morphs ? 1.f / (m_manager.getRange(level) - m_manager.getMorphStart(level)) : 0.f;
+		}
+		m_program.setUniformArray2(m_program.getUniformLocation("lodMorph"), lodMorph.data(), terrain::MaxLodLevels);
+
+		m_stripIndices = terrain::buildStripIndices(terrain::ChunkVertices);
+		glGenBuffers(1, &m_elementbuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementbuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_stripIndices.size() * sizeof(std::uint16_t), m_stripIndices.data(), GL_STATIC_DRAW);
+	}
+
+	const terrain::ChunkManager& getManager() const
+	{
+		return m_manager;
+	}
+
+	void render(const Mat4<Type>& View, const Mat4<Type>& Projection, const Point3d<Type>& CameraPosition)
+	{
+		glBindVertexArray(m_vao);
+		m_program.use();
+
+		// the streamed world is laid out in world space
+		const Mat4<Type> Model = Mat4<Type>::identity();
+
+		// the camera looks down -z of the view space
+		const Point3d<Type> viewDirection(-View(2, 0), -View(2, 1), -View(2, 2));
+
+		{
+			PROFILE_SCOPE("chunk streaming");
+			auto* uploader = UploadServiceInstance::GetInstance();
+
+			// chunks whose vertices are on the GPU are drawn from this frame on
+			size_t done = 0;
+			while (done < m_uploads.size() && uploader->isComplete(m_uploads[done].first))
+				m_manager.completeUpload(m_uploads[done++].second);
+			m_uploads.erase(m_uploads.begin(), m_uploads.begin() + done);
+
+			// written by the upload context: binding it again makes its new content visible here
+			glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_slotBuffer);
+			m_manager.update(CameraPosition, viewDirection, Frustum::fromMatrix(Projection * View), [&](int slot, const terrain::ChunkData& chunk) {
+				const GLsizeiptr chunkBytes = terrain::ChunkVertexCount * sizeof(terrain::TerrainVertex);
+				if (!uploader->hasBudget(chunkBytes))
+					return false;
+
+				m_uploads.emplace_back(uploader->uploadBuffer(m_vbo, slot * chunkBytes, chunkBytes, chunk.getVertices()), chunk.key);
+
+				// the slot is not drawn before its vertices are complete
+				const terrain::ChunkSlotInfo info = terrain::ChunkManager::getSlotInfo(chunk.key);
+				glBufferSubData(GL_SHADER_STORAGE_BUFFER, slot * sizeof(info), sizeof(info), &info);
+				return true;
+			});
+		}
+		PROFILE_COUNTER("drawn chunks", m_manager.getSelectedSlots().size());
+		PROFILE_COUNTER("culled chunks", m_manager.getCulledCount());
+		PROFILE_COUNTER("resident chunks", m_manager.getResidentCount());
+		PROFILE_COUNTER("chunks in flight", m_manager.getInFlightCount());
+		PROFILE_COUNTER("chunks uploaded", m_manager.getUploadedCount());
+		PROFILE_COUNTER("chunks uploading", m_manager.getUploadingCount());
+
+		// view, projection, camera and light come from the frame uniform buffer
+		m_program.setUniform(m_modelMatrixLocation, Model);
+		m_materialUniforms.apply(m_program, m_material);
+
+		const std::vector<int>& slots = m_manager.getSelectedSlots();
+		m_drawCounts.assign(slots.size(), static_cast<GLsizei>(m_stripIndices.size()));
+		m_drawOffsets.assign(slots.size(), nullptr);
+		m_drawBaseVertices.resize(slots.size());
+		for (size_t draw = 0; draw < slots.size(); draw++)
+			m_drawBaseVertices[draw] = static_cast<GLint>(slots[draw] * terrain::ChunkVertexCount);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_slotBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_elementbuffer);
+
+		glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+		glMultiDrawElementsBaseVertex(GL_TRIANGLE_STRIP, m_drawCounts.data(), GL_UNSIGNED_SHORT, m_drawOffsets.data(), static_cast<GLsizei>(slots.size()), m_drawBaseVertices.data());
+		glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+	}
+
+private:
+	GLuint m_vao = 0;
+	GLuint m_vbo = 0;
+	GLuint m_slotBuffer = 0;
+	GLuint m_elementbuffer = 0;
+	ShaderProgram m_program;
+	GLint m_modelMatrixLocation = -1;
+	Material m_material;
+	MaterialUniforms m_materialUniforms;
+
+	FractalNoise m_noise;
+	terrain::ChunkManager m_manager;
+	std::vector<std::pair<UploadService::Ticket, terrain::ChunkKey>> m_uploads;     // in ticket order
+	std::vector<std::uint16_t> m_stripIndices;
+	std::vector<GLsizei> m_drawCounts;
+	std::vector<const void*> m_drawOffsets;
+	std::vector<GLint> m_drawBaseVertices;
+};
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+#include "utils/threading/ThreadPool.h"
+
+#include "engine/profiling/Profiler.h"
+#include "TaskGraph.h"
+
+namespace engine {
+
+
+    TaskGraph::TaskId TaskGraph::add(const char* name, Work work, std::initializer_list<TaskId> dependencies, Affinity affinity)
+    {
+        const TaskId id = push(name, std::move(work), affinity);
+        for (TaskId dependency : dependencies)
+            depend(id, dependency);
+        return id;
+    }
+
+    TaskGraph::TaskId TaskGraph::addParallelFor(const char* name, std::size_t begin, std::size_t end, std::size_t grain, RangeWork body, std::initializer_list<TaskId> dependencies)
+    {
+        // ranges fixed by grain alone, as ThreadPool::parallelFor; an empty task joins them
+        grain = std::max<std::size_t>(grain, 1);
+        const auto shared = std::make_shared<RangeWork>(std::move(body));
+
+        std::vector<TaskId> ranges;
+        for (std::size_t first = begin; first < end; first += grain)
+        {
+            const std::size_t last = std::min(first + grain, end);
+            ranges.push_back(add(name, [shared, first, last] { (*shared)(first, last); }, dependencies));
+        }
+
+        if (ranges.empty())
+            return add(name, [] {}, dependencies);
+
+        const TaskId join = push(name, [] {}, Affinity::Any);
+        for (TaskId range : ranges)
+            depend(join, range);
+        return join;
+    }
+
+    void TaskGraph::run()
+    {
+        if (m_tasks.empty())
+            return;
+
+        // every counter is set before the first task can finish and decrement one
+        m_failed = false;
+        m_remaining.store(m_tasks.size(), std::memory_order_relaxed);
+        for (Task& task : m_tasks)
+            task.waiting.store(task.dependencyCount, std::memory_order_relaxed);
+
+        for (TaskId id = 0; id < m_tasks.size(); ++id)
+        {
+            if (m_tasks[id].dependencyCount == 0)
+                schedule(id);
+        }
+
+        // only tasks of this graph: a pool task may be a chunk to generate
+        while (m_remaining.load(std::memory_order_acquire) != 0)
+        {
+            if (!runMainTask() && !runReadyTask())
+                std::this_thread::yield();
+        }
+
+        m_tasks.clear();
+
+        if (m_error)
+        {
+            std::exception_ptr error = nullptr;
+            std::swap(error, m_error);
+            std::rethrow_exception(error);
+        }
+    }
+
+    // private
+    TaskGraph::TaskId TaskGraph::push(const char* name, Work work, Affinity affinity)
+    {
+        const TaskId id = m_tasks.size();
+        Task& task = m_tasks.emplace_back();
+        task.name = name;
+        task.work = std::move(work);
+        task.affinity = affinity;
+        return id;
+    }
+
+    void TaskGraph::depend(TaskId id, TaskId dependency)
+    {
+        // dependencies come first, so the graph can't have a cycle
+        assert(dependency < id);
+        m_tasks[dependency].dependents.push_back(id);
+        ++m_tasks[id].dependencyCount;
+    }
+
+    void TaskGraph::schedule(TaskId id)
+    {
+        if (m_tasks[id].affinity == Affinity::Main)
+        {
+            std::lock_guard<std::mutex> lock(m_mainMutex);
+            m_mainTasks.push_back(id);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_ready->mutex);
+            m_ready->tasks.push_back(id);
+        }
+
+        // a helper only touches the graph when it gets a task, and run() is waiting on that task then
+        utils::ThreadPoolInstance::GetInstance()->submit([this, ready = m_ready]
+            {
+                TaskId readyId;
+                if (popReady(*ready, readyId))
+                    execute(readyId);
+            });
+    }
+
+    void TaskGraph::execute(TaskId id)
+    {
+        Task& task = m_tasks[id];
+        if (!m_failed.load(std::memory_order_relaxed))
+        {
+            PROFILE_SCOPE(task.name);
+            try
+            {
+                task.work();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m_errorMutex);
+                if (!m_error)
+                    m_error = std::current_exception();
+                m_failed = true;
+            }
+        }
+
+        for (TaskId dependent : task.dependents)
+        {
+            if (m_tasks[dependent].waiting.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                schedule(dependent);
+        }
+
+        // last: run() may return as soon as this reaches 0
+        m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    bool TaskGraph::runMainTask()
+    {
+        TaskId id;
+        {
+            std::lock_guard<std::mutex> lock(m_mainMutex);
+            if (m_mainTasks.empty())
+                return false;
+            id = m_mainTasks.front();
+            m_mainTasks.pop_front();
+        }
+
+        execute(id);
+        return true;
+    }
+
+    bool TaskGraph::runReadyTask()
+    {
+        TaskId id;
+        if (!popReady(*m_ready, id))
+            return false;
+
+        execute(id);
+        return true;
+    }
+
+    bool TaskGraph::popReady(ReadyQueue& queue, TaskId& id)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+        id = queue.tasks.front();
+        queue.tasks.pop_front();
+        return true;
+    }
+
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace engine {
+
+    // Tasks with dependencies, run on the shared utils::ThreadPool. One thread builds
+    // the graph, each task after the tasks it depends on, then run() starts the tasks
+    // without dependencies and every other one once its last dependency is done. Tasks
+    // with Affinity::Main run on the thread that calls run(), the one holding the GL
+    // context. While it waits, that thread runs the other ready tasks of the graph, but
+    // never unrelated pool work such as chunk generation, which may take longer than a
+    // frame.
+    class TaskGraph
+    {
+    public:
+        using TaskId = std::size_t;
+        using Work = std::function<void()>;
+        using RangeWork = std::function<void(std::size_t first, std::size_t last)>;
+
+        enum class Affinity
+        {
+            Any,    // a worker of the pool or the caller of run()
+            Main    // the caller of run() only: GL calls
+        };
+
+        TaskGraph() = default;
+        TaskGraph(const TaskGraph&) = delete;
+        TaskGraph& operator=(const TaskGraph&) = delete;
+
+        // Adds work, to run once the tasks of dependencies are done; they must have been
+        // added before. name is the profiler zone of the task (a string literal).
+        TaskId add(const char* name, Work work, std::initializer_list<TaskId> dependencies = {}, Affinity affinity = Affinity::Any);
+
+        // A task calling body(first, last) over [begin, end) in ranges of grain items, as
+        // ThreadPool::parallelFor: its dependents start once every range is done. Each
+        // range is a task of the graph.
+        TaskId addParallelFor(const char* name, std::size_t begin, std::size_t end, std::size_t grain, RangeWork body, std::initializer_list<TaskId> dependencies = {});
+
+        // Runs the tasks added since the last run and empties the graph. Once a task
+        // throws, the tasks not started yet are skipped, and run() rethrows the first
+        // exception when the running ones are done. Tasks can't add tasks.
+        void run();
+
+        std::size_t getTaskCount() const { return m_tasks.size(); }
+
+    private:
+        struct Task
+        {
+            const char* name = nullptr;
+            Work work;
+            Affinity affinity = Affinity::Any;
+            std::size_t dependencyCount = 0;
+            std::vector<TaskId> dependents;
+            std::atomic<std::size_t> waiting = 0;   // dependencies not done yet, during run()
+        };
+
+        // Ready Any tasks. The pool gets a helper per task, which runs one if the caller
+        // of run() has not taken it first; helpers still queued when run() returns hold
+        // the queue alive and find it empty.
+        struct ReadyQueue
+        {
+            std::mutex mutex;
+            std::deque<TaskId> tasks;
+        };
+
+        TaskId push(const char* name, Work work, Affinity affinity);
+        void depend(TaskId id, TaskId dependency);
+
+        // Queues a ready task for the pool and the caller, or on the main queue
+        void schedule(TaskId id);
+        void execute(TaskId id);
+
+        // Run one ready Main task, or one ready Any task. False when there is none.
+        bool runMainTask();
+        bool runReadyTask();
+
+        static bool popReady(ReadyQueue& queue, TaskId& id);
+
+        // a deque keeps the tasks in place as it grows, atomics can't move
+        std::deque<Task> m_tasks;
+        std::atomic<std::size_t> m_remaining = 0;
+
+        std::mutex m_mainMutex;
+        std::deque<TaskId> m_mainTasks;
+        std::shared_ptr<ReadyQueue> m_ready = std::make_shared<ReadyQueue>();
+
+        std::mutex m_errorMutex;
+        std::exception_ptr m_error;
+        std::atomic<bool> m_failed = false;
+    };
+
+}
@@ -0,0 +1,363 @@
+#include "Profiler.h"
+
+#if TERRAIN_PROFILER
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include <imgui.h>
+
+namespace engine {
+
+    namespace {
+
+        std::int64_t steadyNowNs()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // small stable id per thread for the trace, 0 being the GPU
+        std::uint32_t currentThreadId()
+        {
+            static std::atomic<std::uint32_t> nextId{ 1 };
+            thread_local const std::uint32_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+            return id;
+        }
+
+        thread_local int t_cpuDepth = 0;
+
+        // nearest-rank percentile of sorted values
+        float percentile(const std::vector<float>& sorted, float fraction)
+        {
+            if (sorted.empty())
+                return 0.f;
+            const std::size_t rank = static_cast<std::size_t>(fraction * static_cast<float>(sorted.size() - 1) + 0.5f);
+            return sorted[std::min(rank, sorted.size() - 1)];
+        }
+
+    }
+
+    void Profiler::History::push(float value)
+    {
+        values[next] = value;
+        next = (next + 1) % values.size();
+        count = std::min(count + 1, values.size());
+    }
+
+    Profiler::Profiler()
+        : m_startNs(steadyNowNs())
+    {
+    }
+
+    Profiler::~Profiler()
+    {
+        if (!m_allQueries.empty())
+            glDeleteQueries(static_cast<GLsizei>(m_allQueries.size()), m_allQueries.data());
+    }
+
+    std::int64_t Profiler::now() const
+    {
+        return steadyNowNs() - m_startNs;
+    }
+
+    void Profiler::beginFrame()
+    {
+        m_frameStartNs = now();
+
+        if (!m_gpuCalibrated)
+        {
+            GLint64 gpuNow = 0;
+            glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+            m_gpuToCpuNs = now() - gpuNow;
+            m_gpuCalibrated = true;
+        }
+
+        // this frame reuses the slot of the frame GpuLatency frames ago: read it first
+        std::vector<PendingGpuZone>& zones = m_gpuFrames[m_frameIndex % GpuLatency];
+        resolveGpuFrame(zones);
+        zones.clear();
+        m_gpuStack.clear();
+    }
+
+    void Profiler::endFrame()
+    {
+        const std::int64_t frameEndNs = now();
+        m_frameHistory.push((frameEndNs - m_frameStartNs) * 1e-6f);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (const Event& event : m_frameEvents)
+            addToHistory(event.name, false, (event.endNs - event.startNs) * 1e-6f);
+
+        for (auto& [name, history] : m_histories)
+        {
+            if (history.frameSum < 0.f)
+                continue;
+            history.push(history.frameSum);
+            history.frameSum = -1.f;
+        }
+
+        if (m_captureFramesLeft > 0)
+        {
+            m_traceEvents.insert(m_traceEvents.end(), m_frameEvents.begin(), m_frameEvents.end());
+            m_traceEvents.push_back({ "frame", m_frameStartNs, frameEndNs, currentThreadId(), -1 });
+            if (--m_captureFramesLeft == 0)
+                m_captureDrainFrames = static_cast<int>(GpuLatency);
+        }
+        else if (m_captureDrainFrames > 0 && --m_captureDrainFrames == 0)
+        {
+            writeTrace();
+        }
+
+        m_frameEvents.clear();
+        ++m_frameIndex;
+    }
+
+    void Profiler::recordCpuZone(const char* name, std::int64_t startNs, std::int64_t endNs, int depth)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frameEvents.push_back({ name, startNs, endNs, currentThreadId(), depth });
+    }
+
+    GLuint Profiler::acquireQuery()
+    {
+        if (m_freeQueries.empty())
+        {
+            GLuint queries[32];
+            glGenQueries(32, queries);
+            m_freeQueries.insert(m_freeQueries.end(), queries, queries + 32);
+            m_allQueries.insert(m_allQueries.end(), queries, queries + 32);
+        }
+
+        const GLuint query = m_freeQueries.back();
+        m_freeQueries.pop_back();
+        return query;
+    }
+
+    int Profiler::beginGpuZone(const char* name)
+    {
+        std::vector<PendingGpuZone>& zones = m_gpuFrames[m_frameIndex % GpuLatency];
+
+        PendingGpuZone zone;
+        zone.name = name;
+        zone.depth = static_cast<int>(m_gpuStack.size());
+        zone.queries[0] = acquireQuery();
+        zone.queries[1] = acquireQuery();
+        glQueryCounter(zone.queries[0], GL_TIMESTAMP);
+
+        zones.push_back(zone);
+        m_gpuStack.push_back(static_cast<int>(zones.size()) - 1);
+        return m_gpuStack.back();
+    }
+
+    void Profiler::endGpuZone(int zone)
+    {
+        glQueryCounter(m_gpuFrames[m_frameIndex % GpuLatency][zone].queries[1], GL_TIMESTAMP);
+        m_gpuStack.pop_back();
+    }
+
+    // Never waits: a zone whose queries are still pending is dropped
+    void Profiler::resolveGpuFrame(std::vector<PendingGpuZone>& zones)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (const PendingGpuZone& zone : zones)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(zone.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+            if (available)
+            {
+                GLuint64 begin = 0;
+                GLuint64 end = 0;
+                glGetQueryObjectui64v(zone.queries[0], GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(zone.queries[1], GL_QUERY_RESULT, &end);
+
+                addToHistory(zone.name, true, (end - begin) * 1e-6f);
+
+                if (m_captureFramesLeft > 0 || m_captureDrainFrames > 0)
+                    m_traceEvents.push_back({ zone.name, static_cast<std::int64_t>(begin) + m_gpuToCpuNs, static_cast<std::int64_t>(end) + m_gpuToCpuNs, 0, zone.depth });
+            }
+
+            m_freeQueries.push_back(zone.queries[0]);
+            m_freeQueries.push_back(zone.queries[1]);
+        }
+    }
+
+    // Sums the zone over the frame; endFrame pushes the sum
+    void Profiler::addToHistory(const std::string& name, bool gpu, float milliseconds)
+    {
+        const std::string key = gpu ? "gpu: " + name : name;
+
+        auto it = m_histories.find(key);
+        if (it == m_histories.end())
+        {
+            it = m_histories.emplace(key, History()).first;
+            it->second.gpu = gpu;
+            it->second.frameSum = -1.f;
+            m_zoneOrder.push_back(key);
+        }
+
+        it->second.frameSum = std::max(it->second.frameSum, 0.f) + milliseconds;
+    }
+
+    void Profiler::setCounter(const char* name, double value)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_counters[name] = value;
+    }
+
+    void Profiler::captureTrace(int frameCount, const std::string& path)
+    {
+        if (isCapturing())
+            return;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_traceEvents.clear();
+        m_capturePath = path;
+        m_captureFramesLeft = std::max(frameCount, 1);
+
+        // clocks drift apart: re-anchor the GPU timeline on the CPU one
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        m_gpuToCpuNs = now() - gpuNow;
+    }
+
+    void Profiler::writeTrace()
+    {
+        std::FILE* out = std::fopen(m_capturePath.c_str(), "w");
+        if (out == nullptr)
+        {
+            std::fprintf(stderr, "Profiler: cannot write %s\n", m_capturePath.c_str());
+            m_capturePath.clear();
+            m_traceEvents.clear();
+            return;
+        }
+
+        // complete events ("X"), timestamps in microseconds
+        std::fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+        std::fprintf(out, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"GPU\"}}");
+        for (const Event& event : m_traceEvents)
+        {
+            std::fprintf(out, ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+                event.name, event.thread == 0 ? "gpu" : "cpu", event.thread, event.startNs * 1e-3, (event.endNs - event.startNs) * 1e-3);
+        }
+        std::fprintf(out, "\n]}\n");
+        std::fclose(out);
+
+        std::fprintf(stderr, "Profiler: wrote %zu events to %s\n", m_traceEvents.size(), m_capturePath.c_str());
+        m_capturePath.clear();
+        m_traceEvents.clear();
+    }
+
+    std::vector<Profiler::ZoneStats> Profiler::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto makeStats = [](const std::string& name, const History& history) {
+            std::vector<float> sorted(history.values.begin(), history.values.begin() + history.count);
+            std::sort(sorted.begin(), sorted.end());
+
+            ZoneStats stats;
+            stats.name = name;
+            stats.gpu = history.gpu;
+            if (!sorted.empty())
+            {
+                float sum = 0.f;
+                for (float value : sorted)
+                    sum += value;
+                stats.average = sum / static_cast<float>(sorted.size());
+                stats.p50 = percentile(sorted, 0.50f);
+                stats.p95 = percentile(sorted, 0.95f);
+                stats.p99 = percentile(sorted, 0.99f);
+                stats.max = sorted.back();
+            }
+            return stats;
+        };
+
+        std::vector<ZoneStats> stats;
+        stats.push_back(makeStats("frame", m_frameHistory));
+        for (const std::string& name : m_zoneOrder)
+            stats.push_back(makeStats(name, m_histories.at(name)));
+        return stats;
+    }
+
+    void Profiler::drawOverlay()
+    {
+        if (!m_overlayVisible)
+            return;
+
+        const std::vector<ZoneStats> stats = getStats();
+
+        ImGui::SetNextWindowPos(ImVec2(10.f, 10.f), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowBgAlpha(0.8f);
+        if (!ImGui::Begin("Profiler", &m_overlayVisible, ImGuiWindowFlags_AlwaysAutoResize))
+        {
+            ImGui::End();
+            return;
+        }
+
+        // frame times, oldest first
+        std::vector<float> frames(m_frameHistory.count);
+        for (std::size_t i = 0; i < frames.size(); ++i)
+            frames[i] = m_frameHistory.values[(m_frameHistory.next + HistoryLength - frames.size() + i) % HistoryLength];
+
+        const ZoneStats& frame = stats.front();
+        ImGui::Text("frame %.2f ms (p50 %.2f, p95 %.2f, p99 %.2f, max %.2f)", frame.average, frame.p50, frame.p95, frame.p99, frame.max);
+        ImGui::PlotLines("##frames", frames.data(), static_cast<int>(frames.size()), 0, nullptr, 0.f, std::max(frame.max, 1.f), ImVec2(360.f, 60.f));
+
+        if (ImGui::BeginTable("zones", 6))
+        {
+            for (const char* header : { "zone (ms)", "avg", "p50", "p95", "p99", "max" })
+                ImGui::TableSetupColumn(header);
+            ImGui::TableHeadersRow();
+
+            for (std::size_t i = 1; i < stats.size(); ++i)
+            {
+                const ZoneStats& zone = stats[i];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::Text("%s", zone.name.c_str());
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", zone.average);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", zone.p50);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", zone.p95);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", zone.p99);
+                ImGui::TableNextColumn(); ImGui::Text("%.3f", zone.max);
+            }
+            ImGui::EndTable();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_counters.empty())
+                ImGui::Separator();
+            for (const auto& [name, value] : m_counters)
+                ImGui::Text("%s: %g", name.c_str(), value);
+        }
+
+        ImGui::Separator();
+        if (isCapturing())
+            ImGui::Text("capturing trace...");
+        else if (ImGui::Button("Capture 120 frames to trace.json"))
+            captureTrace(120, "trace.json");
+
+        ImGui::End();
+    }
+
+    CpuZone::CpuZone(const char* name)
+        : m_name(name)
+        , m_startNs(ProfilerInstance::GetInstance()->now())
+        , m_depth(t_cpuDepth++)
+    {
+    }
+
+    CpuZone::~CpuZone()
+    {
+        --t_cpuDepth;
+        Profiler* profiler = ProfilerInstance::GetInstance();
+        profiler->recordCpuZone(m_name, m_startNs, profiler->now(), m_depth);
+    }
+
+}
+
+#endif
@@ -0,0 +1,185 @@
+#pragma once
+
+// Frame profiler: scoped CPU zones, GL timer query zones, a rolling history with
+// percentiles, an ImGui overlay and Chrome trace (Perfetto) capture.
+//
+// Compiled in when TERRAIN_PROFILER is 1 (CMake option ENABLE_PROFILER). Otherwise
+// every PROFILE_* macro expands to nothing and none of this header is compiled.
+
+#if TERRAIN_PROFILER
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <utils/design_patterns/Singleton.h>
+
+namespace engine {
+
+    class Profiler
+    {
+        friend class utils::Singleton<Profiler>;
+
+    public:
+        // frames kept for the statistics and the overlay plots
+        static constexpr std::size_t HistoryLength = 240;
+
+        // frames between a GPU zone and the read of its timer queries
+        static constexpr std::size_t GpuLatency = 4;
+
+        struct ZoneStats
+        {
+            std::string name;
+            bool gpu = false;
+            float average = 0.f;    // milliseconds per frame
+            float p50 = 0.f;
+            float p95 = 0.f;
+            float p99 = 0.f;
+            float max = 0.f;
+        };
+
+        ~Profiler();
+
+        void beginFrame();
+        void endFrame();
+
+        // Thread-safe; name must outlive the profiler (a string literal)
+        void recordCpuZone(const char* name, std::int64_t startNs, std::int64_t endNs, int depth);
+
+        // Render thread only, with a current GL context
+        int beginGpuZone(const char* name);
+        void endGpuZone(int zone);
+
+        // Value shown in the overlay, replaced every time it is set
+        void setCounter(const char* name, double value);
+
+        // Writes the next frameCount frames to path as Chrome trace JSON
+        void captureTrace(int frameCount, const std::string& path);
+        bool isCapturing() const { return m_captureFramesLeft > 0 || !m_capturePath.empty(); }
+
+        std::vector<ZoneStats> getStats() const;
+
+        void setOverlayVisible(bool visible) { m_overlayVisible = visible; }
+        bool isOverlayVisible() const { return m_overlayVisible; }
+        void drawOverlay();
+
+        // Nanoseconds since the profiler started
+        std::int64_t now() const;
+
+    private:
+        Profiler();
+        Profiler(const Profiler&) = delete;
+
+        struct Event
+        {
+            const char* name = nullptr;
+            std::int64_t startNs = 0;
+            std::int64_t endNs = 0;
+            std::uint32_t thread = 0;   // 0 is the GPU timeline
+            int depth = 0;
+        };
+
+        struct PendingGpuZone
+        {
+            const char* name = nullptr;
+            GLuint queries[2] = {};
+            int depth = 0;
+        };
+
+        struct History
+        {
+            bool gpu = false;
+            std::vector<float> values = std::vector<float>(HistoryLength, 0.f);
+            std::size_t next = 0;
+            std::size_t count = 0;
+            float frameSum = 0.f;   // accumulated over the current frame
+
+            void push(float value);
+        };
+
+        GLuint acquireQuery();
+        void resolveGpuFrame(std::vector<PendingGpuZone>& zones);
+        void addToHistory(const std::string& name, bool gpu, float milliseconds);
+        void writeTrace();
+
+        std::int64_t m_startNs = 0;
+        std::int64_t m_frameStartNs = 0;
+        std::uint64_t m_frameIndex = 0;
+
+        mutable std::mutex m_mutex;
+        std::vector<Event> m_frameEvents;
+        std::unordered_map<std::string, History> m_histories;
+        std::vector<std::string> m_zoneOrder;
+        std::map<std::string, double> m_counters;
+        History m_frameHistory;
+
+        // GPU zones of the last GpuLatency frames, and timestamp queries to reuse
+        std::vector<PendingGpuZone> m_gpuFrames[GpuLatency];
+        std::vector<int> m_gpuStack;
+        std::vector<GLuint> m_freeQueries;
+        std::vector<GLuint> m_allQueries;
+        std::int64_t m_gpuToCpuNs = 0;
+        bool m_gpuCalibrated = false;
+
+        int m_captureFramesLeft = 0;
+        int m_captureDrainFrames = 0;
+        std::string m_capturePath;
+        std::vector<Event> m_traceEvents;
+
+        bool m_overlayVisible = true;
+    };
+
+    using ProfilerInstance = utils::Singleton<Profiler>;
+
+    // Records the time between its construction and its destruction
+    class CpuZone
+    {
+    public:
+        explicit CpuZone(const char* name);
+        ~CpuZone();
+
+        CpuZone(const CpuZone&) = delete;
+        CpuZone& operator=(const CpuZone&) = delete;
+
+    private:
+        const char* m_name;
+        std::int64_t m_startNs;
+        int m_depth;
+    };
+
+    // Brackets the GL commands issued during its lifetime with timestamp queries
+    class GpuZone
+    {
+    public:
+        explicit GpuZone(const char* name) : m_zone(ProfilerInstance::GetInstance()->beginGpuZone(name)) {}
+        ~GpuZone() { ProfilerInstance::GetInstance()->endGpuZone(m_zone); }
+
+        GpuZone(const GpuZone&) = delete;
+        GpuZone& operator=(const GpuZone&) = delete;
+
+    private:
+        int m_zone;
+    };
+
+}
+
+#define TERRAIN_PROFILE_CONCAT_INNER(a, b) a##b
+#define TERRAIN_PROFILE_CONCAT(a, b) TERRAIN_PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_SCOPE(name) ::engine::CpuZone TERRAIN_PROFILE_CONCAT(profileCpuZone, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name) ::engine::GpuZone TERRAIN_PROFILE_CONCAT(profileGpuZone, __LINE__)(name)
+#define PROFILE_COUNTER(name, value) ::engine::ProfilerInstance::GetInstance()->setCounter(name, static_cast<double>(value))
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_GPU_SCOPE(name) ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+
+#endif
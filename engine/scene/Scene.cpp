@@ -50,6 +50,15 @@ namespace engine {
 	{
 	}
 
+	void IScene::simulate(const float& step, double time)
+	{
+		update(step);
+	}
+
+	void IScene::prepareRender(double time)
+	{
+	}
+
 	sf::RenderWindow& IScene::getWindow()
 	{
 		return m_window;
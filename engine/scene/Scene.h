@@ -20,9 +20,19 @@ namespace engine {
         virtual void onEndPlay();
 
         virtual void processInput(sf::Event& inputEvent);
+        // Work the frame can spread over the thread pool goes in Game::getFrameTasks()
         virtual void update(const float& deltaTime);
         virtual void render();
 
+        // Simulation thread mode (Game::setSimulationRate). simulate() replaces update():
+        // it runs on the simulation thread once per tick of step seconds, ending at time
+        // on the simulation clock, and must use neither GL nor Game::getFrameTasks(). By
+        // default it calls update(), for scenes whose update() uses neither.
+        // prepareRender() runs on the main thread before every render(), with the
+        // simulation time to draw: states are interpolated there.
+        virtual void simulate(const float& step, double time);
+        virtual void prepareRender(double time);
+
 
         sf::RenderWindow& getWindow();
 
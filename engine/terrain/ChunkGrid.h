@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace terrain {
+
+	// The terrain is drawn in square chunks of ChunkQuads x ChunkQuads quads. Every chunk
+	// owns ChunkVertexCount consecutive vertices, so one 16-bit index buffer serves all
+	// chunks once offset by the chunk's base vertex.
+	constexpr int ChunkQuads = 128;
+	constexpr int ChunkVertices = ChunkQuads + 1;
+	constexpr int ChunkVertexCount = ChunkVertices * ChunkVertices;
+
+	constexpr std::uint16_t RestartIndex = 0xFFFF;
+	static_assert(ChunkVertexCount < RestartIndex, "chunk vertices must be addressable with 16-bit indices");
+
+	// Triangle strips over a verticesPerSide x verticesPerSide chunk, one strip per quad
+	// row, separated by RestartIndex. Quad (c, r) gives the triangles (p00, p01, p10)
+	// and (p01, p11, p10), where p01 is one row further and p10 one column further,
+	// matching the winding of the face normals.
+	inline std::vector<std::uint16_t> buildStripIndices(int verticesPerSide)
+	{
+		std::vector<std::uint16_t> indices;
+		indices.reserve(static_cast<size_t>(verticesPerSide - 1) * (verticesPerSide * 2 + 1));
+
+		for (int row = 0; row + 1 < verticesPerSide; ++row) {
+			if (row > 0)
+				indices.push_back(RestartIndex);
+
+			for (int column = 0; column < verticesPerSide; ++column) {
+				indices.push_back(static_cast<std::uint16_t>(row * verticesPerSide + column));
+				indices.push_back(static_cast<std::uint16_t>((row + 1) * verticesPerSide + column));
+			}
+		}
+		return indices;
+	}
+
+	// Splits a width x height sample grid in chunks. Chunks on the far edges reach past
+	// the grid; their extra vertices are clamped onto the last row or column and only
+	// produce degenerate triangles.
+	class ChunkGrid
+	{
+	public:
+		ChunkGrid() = default;
+
+		ChunkGrid(int width, int height)
+			: m_chunksX(std::max((width - 2) / ChunkQuads + 1, 1))
+			, m_chunksZ(std::max((height - 2) / ChunkQuads + 1, 1))
+		{}
+
+		int getChunksX() const { return m_chunksX; }
+		int getChunksZ() const { return m_chunksZ; }
+		int getChunkCount() const { return m_chunksX * m_chunksZ; }
+
+		int getFirstColumn(int chunk) const { return (chunk % m_chunksX) * ChunkQuads; }
+		int getFirstRow(int chunk) const { return (chunk / m_chunksX) * ChunkQuads; }
+
+		size_t getBaseVertex(int chunk) const { return static_cast<size_t>(chunk) * ChunkVertexCount; }
+		size_t getVertexCount() const { return static_cast<size_t>(getChunkCount()) * ChunkVertexCount; }
+
+	private:
+		int m_chunksX = 0;
+		int m_chunksZ = 0;
+	};
+
+}
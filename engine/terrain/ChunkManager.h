@@ -0,0 +1,497 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "utils/math/Frustum.h"
+#include "utils/math/Math.h"
+#include "utils/math/Noise.h"
+#include "utils/threading/ThreadPool.h"
+
+#include "engine/terrain/ChunkGrid.h"
+#include "engine/terrain/HeightGenerator.h"
+#include "engine/terrain/Kernels.h"
+#include "engine/terrain/Heightfield.h"
+#include "engine/terrain/LodQuadtree.h"
+#include "engine/terrain/NormalGenerator.h"
+#include "engine/terrain/TerrainVertex.h"
+#include "engine/terrain/TileCache.h"
+
+namespace terrain {
+
+	// Chunk x, z of LOD level `level` of the unbounded world. A level L chunk covers
+	// ChunkQuads * 2^L heightfield samples along each axis.
+	struct ChunkKey
+	{
+		int level = 0;
+		int x = 0;
+		int z = 0;
+
+		bool operator==(const ChunkKey& other) const = default;
+	};
+
+	struct ChunkKeyHash
+	{
+		size_t operator()(const ChunkKey& key) const
+		{
+			const std::uint64_t packed = (static_cast<std::uint64_t>(static_cast<std::uint32_t>(key.x)) << 32) ^ static_cast<std::uint32_t>(key.z);
+			return static_cast<size_t>((packed ^ static_cast<std::uint64_t>(key.level) << 59) * 0x9e3779b97f4a7c15ull);
+		}
+	};
+
+	struct StreamingSettings
+	{
+		float spacing = 0.01f;
+		float baseHeight = -1.f;
+
+		// LOD levels; chunks of the coarsest one tile the area kept around the camera
+		int levelCount = 5;
+
+		// Coarsest chunks kept on each side of the one under the camera
+		int viewRadius = 3;
+
+		// Vertex memory of the resident chunks, in bytes
+		size_t memoryBudget = size_t(128) << 20;
+
+		// Main thread time spent uploading finished chunks per frame
+		float uploadBudgetMs = 2.f;
+
+		// Chunks generated or waiting for upload at once; 0 picks twice the pool concurrency
+		int maxInFlight = 0;
+
+		// Where generated chunks are kept between runs; empty disables the cache
+		std::string cacheDirectory = "cache/terrain";
+
+		LodSettings lod;
+	};
+
+	// A chunk waiting for its upload: freshly generated, or mapped from the tile cache
+	struct ChunkData
+	{
+		ChunkKey key;
+		Aabb bounds;
+		std::vector<TerrainVertex> vertices;
+		utils::MappedFile tile;
+
+		const TerrainVertex* getVertices() const
+		{
+			return tile.isOpen() ? TileCache::getVertices(tile) : vertices.data();
+		}
+	};
+
+	// Where a slot's chunk lies, in heightfield samples, as read by map.vert
+	struct ChunkSlotInfo
+	{
+		int firstColumn = 0;
+		int firstRow = 0;
+		int stride = 1;
+		int level = 0;
+	};
+
+	// Streams the chunks of an unbounded CDLOD terrain around the camera.
+	//
+	// Every frame update() walks the quadtree over the coarsest chunks around the
+	// camera, like LodQuadtree::select, but only through resident chunks: a node whose
+	// children are not all resident yet is drawn itself, and the missing chunks are
+	// requested. Requests are ranked by distance, scaled up when away from the view
+	// direction, and generated on the shared thread pool, at most maxInFlight at once.
+	// Finished chunks are handed to the upload callback on the calling thread until
+	// the upload budget of the frame is spent or the callback turns one down.
+	//
+	// Uploads may run in the background: a chunk handed over takes its slot at once but
+	// is only drawn after completeUpload(), and its ChunkData stays alive until then.
+	//
+	// Resident chunks live in a fixed number of vertex slots (memoryBudget / chunk size)
+	// recycled in least recently used order, so memory stays bounded wherever the
+	// camera goes. Chunks drawn in the current frame are never evicted. A pool without
+	// workers generates inline, at most maxInFlight chunks per update().
+	class ChunkManager
+	{
+	public:
+		ChunkManager(const FractalNoise& noise, const StreamingSettings& settings = StreamingSettings())
+			: m_noise(noise)
+			, m_settings(settings)
+		{
+			m_settings.levelCount = std::clamp(m_settings.levelCount, 1, MaxLodLevels);
+
+			const size_t slotBytes = ChunkVertexCount * sizeof(TerrainVertex);
+			m_slotCapacity = static_cast<int>(std::max<size_t>(m_settings.memoryBudget / slotBytes, 1));
+			for (int slot = m_slotCapacity - 1; slot >= 0; --slot)
+				m_freeSlots.push_back(slot);
+
+			if (m_settings.maxInFlight <= 0)
+				m_settings.maxInFlight = static_cast<int>(2 * utils::ThreadPoolInstance::GetInstance()->getConcurrency());
+
+			// heights are quantized over the whole range the noise can reach
+			const float bound = m_noise.getAmplitudeBound();
+			m_quantizer.minimum = m_settings.baseHeight - bound;
+			m_quantizer.extent = std::max(2.f * bound, 1e-6f);
+
+			m_cache = TileCache(m_settings.cacheDirectory, hashGenerator(m_noise.getSettings(), m_settings.spacing, m_settings.baseHeight, m_quantizer, getKernels().isa));
+
+			for (int level = 0; level < m_settings.levelCount; ++level) {
+				m_ranges[level] = m_settings.lod.rangeFactor * getChunkSize(level);
+				m_morphStarts[level] = m_ranges[level] * m_settings.lod.morphStartRatio;
+			}
+			m_ranges[m_settings.levelCount - 1] = std::numeric_limits<float>::max();
+			m_morphStarts[m_settings.levelCount - 1] = std::numeric_limits<float>::max();
+		}
+
+		~ChunkManager()
+		{
+			// generation tasks point at this manager
+			auto* pool = utils::ThreadPoolInstance::GetInstance();
+			while (m_running.load(std::memory_order_acquire) > 0) {
+				if (!pool->runPendingTask())
+					std::this_thread::yield();
+			}
+		}
+
+		ChunkManager(const ChunkManager&) = delete;
+		ChunkManager& operator=(const ChunkManager&) = delete;
+
+		const StreamingSettings& getSettings() const { return m_settings; }
+		const HeightQuantizer& getQuantizer() const { return m_quantizer; }
+		int getSlotCapacity() const { return m_slotCapacity; }
+
+		int getLevelCount() const { return m_settings.levelCount; }
+		float getRange(int level) const { return m_ranges[level]; }
+		float getMorphStart(int level) const { return m_morphStarts[level]; }
+
+		// World size of a chunk of the level
+		float getChunkSize(int level) const
+		{
+			return ChunkQuads * static_cast<float>(1 << level) * m_settings.spacing;
+		}
+
+		static ChunkSlotInfo getSlotInfo(const ChunkKey& key)
+		{
+			const int stride = 1 << key.level;
+			return { key.x * ChunkQuads * stride, key.z * ChunkQuads * stride, stride, key.level };
+		}
+
+		// Slots to draw this frame
+		const std::vector<int>& getSelectedSlots() const { return m_selected; }
+
+		int getResidentCount() const { return static_cast<int>(m_resident.size()); }
+		int getInFlightCount() const { return static_cast<int>(m_inFlight.size()); }
+		int getRequestedCount() const { return static_cast<int>(m_requests.size()); }
+		int getCulledCount() const { return m_culledCount; }
+		int getUploadedCount() const { return m_uploadedCount; }
+		int getUploadingCount() const { return m_uploadingCount; }
+		int getCacheHitCount() const { return m_cacheHits.load(std::memory_order_relaxed); }
+
+		// Selects the slots to draw from the resident chunks, schedules the missing ones
+		// and uploads finished chunks through bool upload(slot, const ChunkData&) until
+		// the upload budget is spent; false keeps the chunk for a later frame.
+		// cameraPosition, viewDirection and frustum are in world space.
+		template<typename Upload>
+		void update(const Point3d<float>& cameraPosition, const Point3d<float>& viewDirection, const Frustum& frustum, Upload&& upload)
+		{
+			++m_frame;
+
+			select(cameraPosition, viewDirection, frustum);
+			schedule();
+			uploadReady(cameraPosition, upload);
+		}
+
+		// The upload of the chunk is on the GPU: it may be drawn from the next update() on
+		void completeUpload(const ChunkKey& key)
+		{
+			Resident* resident = findResident(key);
+			if (resident && resident->uploading) {
+				resident->uploading.reset();
+				--m_uploadingCount;
+			}
+		}
+
+	private:
+		struct Resident
+		{
+			int slot = 0;
+			Aabb bounds;
+			std::uint64_t lastUsed = 0;
+			std::list<ChunkKey>::iterator lru;
+			std::unique_ptr<ChunkData> uploading;    // until completeUpload()
+		};
+
+		struct Request
+		{
+			ChunkKey key;
+			float priority = 0.f;
+		};
+
+		Aabb getNominalBounds(const ChunkKey& key) const
+		{
+			const float size = getChunkSize(key.level);
+
+			Aabb bounds;
+			bounds.minX = key.x * size;
+			bounds.maxX = bounds.minX + size;
+			bounds.minZ = key.z * size;
+			bounds.maxZ = bounds.minZ + size;
+			bounds.minY = m_quantizer.minimum;
+			bounds.maxY = m_quantizer.minimum + m_quantizer.extent;
+			return bounds;
+		}
+
+		Resident* findResident(const ChunkKey& key)
+		{
+			auto it = m_resident.find(key);
+			return it != m_resident.end() ? &it->second : nullptr;
+		}
+
+		void touch(Resident& resident)
+		{
+			resident.lastUsed = m_frame;
+			m_lru.splice(m_lru.begin(), m_lru, resident.lru);
+		}
+
+		void select(const Point3d<float>& cameraPosition, const Point3d<float>& viewDirection, const Frustum& frustum)
+		{
+			m_selected.clear();
+			m_requests.clear();
+			m_culledCount = 0;
+			m_cameraPosition = cameraPosition;
+			m_viewDirection = viewDirection;
+
+			const int top = m_settings.levelCount - 1;
+			const float topSize = getChunkSize(top);
+			const int centerX = static_cast<int>(std::floor(cameraPosition.x / topSize));
+			const int centerZ = static_cast<int>(std::floor(cameraPosition.z / topSize));
+
+			for (int z = centerZ - m_settings.viewRadius; z <= centerZ + m_settings.viewRadius; ++z)
+				for (int x = centerX - m_settings.viewRadius; x <= centerX + m_settings.viewRadius; ++x)
+					selectNode({ top, x, z }, frustum);
+		}
+
+		void selectNode(const ChunkKey& key, const Frustum& frustum)
+		{
+			Resident* resident = findResident(key);
+			const Aabb bounds = resident ? resident->bounds : getNominalBounds(key);
+
+			if (!resident) {
+				request(key, bounds);
+				return;
+			}
+			touch(*resident);
+
+			// not on the GPU yet: like a missing chunk, but already on its way
+			if (resident->uploading)
+				return;
+
+			if (!frustum.intersects(bounds.minX, bounds.minY, bounds.minZ, bounds.maxX, bounds.maxY, bounds.maxZ)) {
+				++m_culledCount;
+				return;
+			}
+
+			const float childRange = key.level > 0 ? m_ranges[key.level - 1] : 0.f;
+			if (key.level > 0 && distanceSquared(bounds, m_cameraPosition) < childRange * childRange) {
+				ChunkKey children[4];
+				bool childrenResident = true;
+				for (int child = 0; child < 4; ++child) {
+					children[child] = { key.level - 1, key.x * 2 + (child & 1), key.z * 2 + (child >> 1) };
+					const Resident* childResident = findResident(children[child]);
+					if (!childResident || childResident->uploading) {
+						childrenResident = false;
+						if (!childResident)
+							request(children[child], getNominalBounds(children[child]));
+					}
+				}
+
+				if (childrenResident) {
+					for (const ChunkKey& child : children)
+						selectNode(child, frustum);
+					return;
+				}
+			}
+
+			m_selected.push_back(resident->slot);
+		}
+
+		// Nearest first, chunks behind the camera count up to twice as far
+		void request(const ChunkKey& key, const Aabb& bounds)
+		{
+			const Point3d<float> toCenter(0.5f * (bounds.minX + bounds.maxX) - m_cameraPosition.x, 0.f, 0.5f * (bounds.minZ + bounds.maxZ) - m_cameraPosition.z);
+			const float length = std::sqrt(toCenter.x * toCenter.x + toCenter.z * toCenter.z);
+			const float facing = length > 0.f ? (toCenter.x * m_viewDirection.x + toCenter.z * m_viewDirection.z) / length : 1.f;
+
+			m_requests.push_back({ key, std::sqrt(distanceSquared(bounds, m_cameraPosition)) * (1.5f - 0.5f * facing) });
+		}
+
+		void schedule()
+		{
+			std::sort(m_requests.begin(), m_requests.end(), [](const Request& a, const Request& b) {
+				return a.priority < b.priority;
+			});
+
+			auto* pool = utils::ThreadPoolInstance::GetInstance();
+			for (const Request& request : m_requests) {
+				if (static_cast<int>(m_inFlight.size()) >= m_settings.maxInFlight)
+					break;
+				if (!m_inFlight.insert(request.key).second)
+					continue;
+
+				m_running.fetch_add(1, std::memory_order_relaxed);
+				pool->submit([this, key = request.key] {
+					auto data = std::make_unique<ChunkData>();
+					generate(key, *data);
+					{
+						std::lock_guard<std::mutex> lock(m_readyMutex);
+						m_ready.push_back(std::move(data));
+					}
+					m_running.fetch_sub(1, std::memory_order_release);
+				});
+			}
+		}
+
+		// Heights over the chunk plus a one-sample border, so the normals on its edges
+		// use the same central differences as its neighbours' and no seam shows
+		void generate(const ChunkKey& key, ChunkData& data)
+		{
+			data.key = key;
+			if (m_cache.load(key.level, key.x, key.z, data.tile, data.bounds)) {
+				m_cacheHits.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			const ChunkSlotInfo info = getSlotInfo(key);
+			const float step = m_settings.spacing * info.stride;
+			const int border = 1;
+
+			Heightfield<float> field(ChunkVertices + 2 * border, ChunkVertices + 2 * border, step,
+				(info.firstColumn - border * info.stride) * m_settings.spacing, (info.firstRow - border * info.stride) * m_settings.spacing);
+			generateHeights(field, m_noise, m_settings.baseHeight);
+			computeGradientNormals(field);
+
+			data.vertices.resize(ChunkVertexCount);
+			packChunkAt(field, border, border, 1, m_quantizer, data.vertices.data());
+
+			data.bounds = getNominalBounds(key);
+			data.bounds.minY = std::numeric_limits<float>::max();
+			data.bounds.maxY = std::numeric_limits<float>::lowest();
+			for (int row = border; row < border + ChunkVertices; ++row) {
+				const float* heights = field.getRow(row);
+				for (int column = border; column < border + ChunkVertices; ++column) {
+					data.bounds.minY = std::min(data.bounds.minY, heights[column]);
+					data.bounds.maxY = std::max(data.bounds.maxY, heights[column]);
+				}
+			}
+
+			m_cache.store(key.level, key.x, key.z, data.bounds, data.vertices.data());
+		}
+
+		// A free slot, or the least recently used one not drawn this frame and not uploading
+		int acquireSlot()
+		{
+			if (!m_freeSlots.empty()) {
+				const int slot = m_freeSlots.back();
+				m_freeSlots.pop_back();
+				return slot;
+			}
+
+			// from the least recently used: a chunk still uploading must not hold back the others
+			for (auto victim = m_lru.rbegin(); victim != m_lru.rend(); ++victim) {
+				auto it = m_resident.find(*victim);
+				if (it->second.lastUsed == m_frame || it->second.uploading)
+					continue;
+
+				const int slot = it->second.slot;
+				m_lru.erase(std::next(victim).base());
+				m_resident.erase(it);
+				return slot;
+			}
+			return -1;
+		}
+
+		template<typename Upload>
+		void uploadReady(const Point3d<float>& cameraPosition, Upload& upload)
+		{
+			m_uploadedCount = 0;
+			{
+				std::lock_guard<std::mutex> lock(m_readyMutex);
+				for (auto& data : m_ready)
+					m_arrived.push_back(std::move(data));
+				m_ready.clear();
+			}
+			if (m_arrived.empty())
+				return;
+
+			// nearest last, so they are popped first
+			std::sort(m_arrived.begin(), m_arrived.end(), [&](const auto& a, const auto& b) {
+				return distanceSquared(a->bounds, cameraPosition) > distanceSquared(b->bounds, cameraPosition);
+			});
+
+			using Clock = std::chrono::steady_clock;
+			const auto deadline = Clock::now() + std::chrono::duration<float, std::milli>(m_settings.uploadBudgetMs);
+
+			while (!m_arrived.empty() && Clock::now() < deadline) {
+				const int slot = acquireSlot();
+				if (slot < 0)
+					break;
+
+				if (!upload(slot, static_cast<const ChunkData&>(*m_arrived.back()))) {
+					// the uploader is full for this frame: the slot stays free, the chunk waits
+					m_freeSlots.push_back(slot);
+					break;
+				}
+
+				std::unique_ptr<ChunkData> data = std::move(m_arrived.back());
+				m_arrived.pop_back();
+				m_inFlight.erase(data->key);
+				++m_uploadedCount;
+				++m_uploadingCount;
+
+				const ChunkKey key = data->key;
+				m_lru.push_front(key);
+				m_resident[key] = { slot, data->bounds, 0, m_lru.begin(), std::move(data) };
+			}
+		}
+
+		FractalNoise m_noise;
+		StreamingSettings m_settings;
+		HeightQuantizer m_quantizer;
+		TileCache m_cache;
+		std::atomic<int> m_cacheHits{ 0 };
+		float m_ranges[MaxLodLevels] = {};
+		float m_morphStarts[MaxLodLevels] = {};
+
+		std::uint64_t m_frame = 0;
+		Point3d<float> m_cameraPosition;
+		Point3d<float> m_viewDirection;
+
+		int m_slotCapacity = 0;
+		std::vector<int> m_freeSlots;
+		std::unordered_map<ChunkKey, Resident, ChunkKeyHash> m_resident;
+		std::list<ChunkKey> m_lru;		// most recently used first
+
+		std::vector<int> m_selected;
+		std::vector<Request> m_requests;
+		int m_culledCount = 0;
+		int m_uploadedCount = 0;
+		int m_uploadingCount = 0;
+
+		// generated or waiting for upload, main thread only
+		std::unordered_set<ChunkKey, ChunkKeyHash> m_inFlight;
+		std::vector<std::unique_ptr<ChunkData>> m_arrived;
+
+		std::mutex m_readyMutex;
+		std::vector<std::unique_ptr<ChunkData>> m_ready;
+		std::atomic<int> m_running{ 0 };
+	};
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <type_traits>
+
+#include "utils/math/Noise.h"
+#include "utils/math/NoiseGraph.h"
+#include "utils/math/RuntimeNoise.h"
+
+#include "engine/terrain/Heightfield.h"
+#include "engine/terrain/Kernels.h"
+#include "engine/terrain/Tiling.h"
+
+namespace terrain {
+
+	// Fills the heights of the tile [columnBegin, columnEnd) x [rowBegin, rowEnd),
+	// one vectorized noise call per row. Noise is FractalNoise or any type with its
+	// sampleLine, which is then inlined into this loop.
+	template<typename Noise = FractalNoise>
+	void generateHeightTile(Heightfield<float>& field, const Noise& noise, float baseHeight, int columnBegin, int columnEnd, int rowBegin, int rowEnd)
+	{
+		const float spacing = field.getSpacing();
+
+		for (int row = rowBegin; row < rowEnd; ++row) {
+			float* heights = field.getRow(row) + columnBegin;
+			const int count = columnEnd - columnBegin;
+
+			noise.sampleLine(field.getOriginX(), field.getZ(row), spacing, 0.f, columnBegin, count, heights);
+			for (int k = 0; k < count; ++k)
+				heights[k] += baseHeight;
+		}
+	}
+
+	// FractalNoise goes through the fbmLine of the instruction set chosen at startup
+	inline void generateHeightTile(Heightfield<float>& field, const FractalNoise& noise, float baseHeight, int columnBegin, int columnEnd, int rowBegin, int rowEnd)
+	{
+		const auto fbmLine = getKernels().fbmLine;
+		const float spacing = field.getSpacing();
+
+		for (int row = rowBegin; row < rowEnd; ++row) {
+			float* heights = field.getRow(row) + columnBegin;
+			const int count = columnEnd - columnBegin;
+
+			fbmLine(noise.getSettings(), field.getOriginX(), field.getZ(row), spacing, 0.f, columnBegin, count, heights);
+			for (int k = 0; k < count; ++k)
+				heights[k] += baseHeight;
+		}
+	}
+
+	// The production presets go through the instruction set chosen at startup, other
+	// compile-time graphs through simd::Native
+	template<typename Graph>
+	void generateHeightTile(Heightfield<float>& field, const GraphNoise<Graph>& noise, float baseHeight, int columnBegin, int columnEnd, int rowBegin, int rowEnd)
+	{
+		auto evaluateLine = &noise::evaluateLine<simd::Native, Graph>;
+		if constexpr (std::is_same_v<Graph, noise::presets::Hills>)
+			evaluateLine = getKernels().hillsLine;
+		else if constexpr (std::is_same_v<Graph, noise::presets::Mountains>)
+			evaluateLine = getKernels().mountainsLine;
+
+		const float spacing = field.getSpacing();
+		for (int row = rowBegin; row < rowEnd; ++row) {
+			float* heights = field.getRow(row) + columnBegin;
+			const int count = columnEnd - columnBegin;
+
+			evaluateLine(noise.getGraph(), noise.getSeed(), field.getOriginX(), field.getZ(row), spacing, 0.f, columnBegin, count, heights);
+			for (int k = 0; k < count; ++k)
+				heights[k] += baseHeight;
+		}
+	}
+
+	// Runtime graphs evaluate the whole tile at once, in blocks spanning several rows,
+	// with the block loops of the instruction set chosen at startup
+	inline void generateHeightTile(Heightfield<float>& field, const noise::RuntimeGraph& graph, float baseHeight, int columnBegin, int columnEnd, int rowBegin, int rowEnd)
+	{
+		float* heights = field.getRow(rowBegin) + columnBegin;
+		graph.sampleGrid(field.getOriginX(), field.getOriginZ(), field.getSpacing(), columnBegin, columnEnd, rowBegin, rowEnd, heights, field.getWidth(), getKernels().runtimeGraph);
+
+		for (int row = rowBegin; row < rowEnd; ++row) {
+			float* rowHeights = field.getRow(row) + columnBegin;
+			for (int k = 0; k < columnEnd - columnBegin; ++k)
+				rowHeights[k] += baseHeight;
+		}
+	}
+
+	template<typename Noise = FractalNoise>
+	void generateHeights(Heightfield<float>& field, const Noise& noise, float baseHeight)
+	{
+		forEachTile(field.getWidth(), field.getHeight(), [&](int columnBegin, int columnEnd, int rowBegin, int rowEnd) {
+			generateHeightTile(field, noise, baseHeight, columnBegin, columnEnd, rowBegin, rowEnd);
+		});
+	}
+
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "utils/math/Math.h"
+#include "utils/memory/AlignedAllocator.h"
+
+// Regular grid of height samples. Sample (column, row) sits at
+// x = originX + column * spacing, z = originZ + row * spacing, so only the heights
+// are stored: one contiguous, 64-byte aligned plane in row-major order (x varies
+// fastest). Normals, when enabled, live in three separate planes with the same
+// layout, which keeps every per-sample pass a unit-stride loop.
+template<typename Type>
+class Heightfield
+{
+public:
+	using Plane = std::vector<Type, utils::AlignedAllocator<Type, 64>>;
+
+	Heightfield() = default;
+
+	Heightfield(int width, int height, Type spacing, Type originX = 0, Type originZ = 0)
+		: m_width(width)
+		, m_height(height)
+		, m_spacing(spacing)
+		, m_originX(originX)
+		, m_originZ(originZ)
+		, m_heights(static_cast<size_t>(width) * height, Type(0))
+	{}
+
+	int getWidth() const { return m_width; }
+	int getHeight() const { return m_height; }
+	Type getSpacing() const { return m_spacing; }
+	Type getOriginX() const { return m_originX; }
+	Type getOriginZ() const { return m_originZ; }
+	size_t getSampleCount() const { return m_heights.size(); }
+
+	size_t index(int column, int row) const { return static_cast<size_t>(row) * m_width + column; }
+
+	Type getX(int column) const { return m_originX + column * m_spacing; }
+	Type getZ(int row) const { return m_originZ + row * m_spacing; }
+
+	Type& at(int column, int row) { return m_heights[index(column, row)]; }
+	const Type& at(int column, int row) const { return m_heights[index(column, row)]; }
+
+	// Height at (column, row) with coordinates clamped to the grid
+	Type atClamped(int column, int row) const
+	{
+		return at(std::clamp(column, 0, m_width - 1), std::clamp(row, 0, m_height - 1));
+	}
+
+	Type* getHeights() { return m_heights.data(); }
+	const Type* getHeights() const { return m_heights.data(); }
+
+	Type* getRow(int row) { return m_heights.data() + index(0, row); }
+	const Type* getRow(int row) const { return m_heights.data() + index(0, row); }
+
+	// Exchanges the height plane with other, which must hold getSampleCount() samples:
+	// double-buffered passes write a whole new plane, then swap it in
+	void swapHeights(Plane& other)
+	{
+		m_heights.swap(other);
+	}
+
+	Point3d<Type> getPosition(int column, int row) const
+	{
+		return Point3d<Type>(getX(column), at(column, row), getZ(row));
+	}
+
+	// Normal planes
+	bool hasNormals() const { return !m_normalX.empty(); }
+
+	void enableNormals()
+	{
+		if (hasNormals())
+			return;
+		m_normalX.assign(m_heights.size(), Type(0));
+		m_normalY.assign(m_heights.size(), Type(1));
+		m_normalZ.assign(m_heights.size(), Type(0));
+	}
+
+	void releaseNormals()
+	{
+		Plane().swap(m_normalX);
+		Plane().swap(m_normalY);
+		Plane().swap(m_normalZ);
+	}
+
+	Type* getNormalsX() { return m_normalX.data(); }
+	Type* getNormalsY() { return m_normalY.data(); }
+	Type* getNormalsZ() { return m_normalZ.data(); }
+	const Type* getNormalsX() const { return m_normalX.data(); }
+	const Type* getNormalsY() const { return m_normalY.data(); }
+	const Type* getNormalsZ() const { return m_normalZ.data(); }
+
+	Point3d<Type> getNormal(int column, int row) const
+	{
+		const size_t i = index(column, row);
+		return Point3d<Type>(m_normalX[i], m_normalY[i], m_normalZ[i]);
+	}
+
+	// CPU memory held by the height and normal planes, in bytes
+	size_t getMemoryUsage() const
+	{
+		return (m_heights.capacity() + m_normalX.capacity() + m_normalY.capacity() + m_normalZ.capacity()) * sizeof(Type);
+	}
+
+private:
+	int m_width = 0;
+	int m_height = 0;
+	Type m_spacing = 1;
+	Type m_originX = 0;
+	Type m_originZ = 0;
+
+	Plane m_heights;
+	Plane m_normalX;
+	Plane m_normalY;
+	Plane m_normalZ;
+};
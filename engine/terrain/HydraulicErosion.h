@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "utils/threading/ThreadPool.h"
+
+#include "engine/terrain/Heightfield.h"
+
+namespace terrain {
+
+	// Droplet model of Hans Theobald Beyer's "Implementation of a method for hydraulic
+	// erosion", in grid cells: a droplet moves one cell per step.
+	struct ErosionSettings
+	{
+		std::uint32_t seed = 1;
+		int dropletCount = 1000000;
+		int batchSize = 1 << 16;        // droplets scattered over the map between two syncs
+		int tileSize = 128;             // raised to fit a droplet footprint, see getTileSize()
+
+		int maxLifetime = 30;           // steps, so cells travelled
+		int radius = 3;                 // cells eroded around the droplet
+		float inertia = 0.05f;
+		float sedimentCapacity = 4.f;
+		float minSedimentCapacity = 0.01f;
+		float erodeSpeed = 0.3f;
+		float depositSpeed = 0.3f;
+		float evaporateSpeed = 0.01f;
+		float gravity = 4.f;
+		float initialWater = 1.f;
+		float initialSpeed = 1.f;
+	};
+
+	// Runs settings.dropletCount droplets over a heightfield, in batches.
+	//
+	// A droplet never reads or writes further than maxLifetime + radius + 1 cells from
+	// where it starts. The map is cut in tiles at least twice that wide and colored like
+	// a 2x2 checkerboard: tiles of one color are a whole tile apart, so their droplets
+	// never touch the same cells and run in parallel without locks. Each batch scatters
+	// its droplets from a hash of (seed, droplet index), buckets them per tile keeping
+	// the index order, then runs the four colors one after the other. The result only
+	// depends on the settings, not on the number of threads or on how erode() calls
+	// split the work.
+	class HydraulicErosion
+	{
+	public:
+		explicit HydraulicErosion(const ErosionSettings& settings = ErosionSettings())
+			: m_settings(settings)
+		{
+			buildBrush();
+		}
+
+		const ErosionSettings& getSettings() const { return m_settings; }
+
+		int getDropletsDone() const { return m_dropletsDone; }
+		bool isFinished() const { return m_dropletsDone >= m_settings.dropletCount; }
+		float getProgress() const { return m_settings.dropletCount > 0 ? static_cast<float>(m_dropletsDone) / m_settings.dropletCount : 1.f; }
+
+		// Starts over, for a new heightfield
+		void reset() { m_dropletsDone = 0; }
+
+		// Width of the tiles, large enough for two droplets of same colored tiles never to meet
+		int getTileSize() const
+		{
+			return std::max(m_settings.tileSize, 2 * (m_settings.maxLifetime + m_settings.radius + 2));
+		}
+
+		// Simulates whole batches until at least dropletBudget more droplets ran or all
+		// are done. Returns the number of droplets simulated.
+		int erode(Heightfield<float>& field, int dropletBudget)
+		{
+			const int before = m_dropletsDone;
+			while (!isFinished() && m_dropletsDone - before < dropletBudget)
+				runBatch(field);
+			return m_dropletsDone - before;
+		}
+
+		void erodeAll(Heightfield<float>& field)
+		{
+			erode(field, m_settings.dropletCount - m_dropletsDone);
+		}
+
+	private:
+		struct BrushSample
+		{
+			int dx;
+			int dz;
+			float weight;
+		};
+
+		struct Droplet
+		{
+			float x;
+			float z;
+		};
+
+		void buildBrush()
+		{
+			const int radius = std::max(m_settings.radius, 0);
+			float sum = 0.f;
+			for (int dz = -radius; dz <= radius; ++dz)
+				for (int dx = -radius; dx <= radius; ++dx) {
+					const float distance = std::sqrt(static_cast<float>(dx * dx + dz * dz));
+					if (distance <= radius) {
+						const float weight = 1.f - distance / (radius + 1);
+						m_brush.push_back({ dx, dz, weight });
+						sum += weight;
+					}
+				}
+			for (BrushSample& sample : m_brush)
+				sample.weight /= sum;
+		}
+
+		static std::uint32_t hash(std::uint32_t value)
+		{
+			// lowbias32 by Chris Wellons
+			value ^= value >> 16;
+			value *= 0x7feb352du;
+			value ^= value >> 15;
+			value *= 0x846ca68bu;
+			value ^= value >> 16;
+			return value;
+		}
+
+		static float toUnit(std::uint32_t value)
+		{
+			return static_cast<float>(value >> 8) * (1.f / 16777216.f);
+		}
+
+		void runBatch(Heightfield<float>& field)
+		{
+			const int width = field.getWidth();
+			const int height = field.getHeight();
+			const int count = std::min(m_settings.batchSize, m_settings.dropletCount - m_dropletsDone);
+			if (width < 2 || height < 2 || count <= 0) {
+				m_dropletsDone = m_settings.dropletCount;
+				return;
+			}
+
+			const int tileSize = getTileSize();
+			const int tilesX = (width + tileSize - 1) / tileSize;
+			const int tilesZ = (height + tileSize - 1) / tileSize;
+
+			// scatter the batch, then bucket the droplets per tile in index order
+			m_tileOf.resize(count);
+			m_tileStart.assign(static_cast<size_t>(tilesX) * tilesZ + 1, 0);
+			m_droplets.resize(count);
+			m_sorted.resize(count);
+
+			for (int i = 0; i < count; ++i) {
+				const std::uint32_t index = static_cast<std::uint32_t>(m_dropletsDone + i);
+				const std::uint32_t key = hash(index ^ hash(m_settings.seed));
+				const Droplet droplet = { toUnit(key) * (width - 1), toUnit(hash(key)) * (height - 1) };
+				const int tile = std::min(static_cast<int>(droplet.z) / tileSize, tilesZ - 1) * tilesX + std::min(static_cast<int>(droplet.x) / tileSize, tilesX - 1);
+
+				m_droplets[i] = droplet;
+				m_tileOf[i] = tile;
+				m_tileStart[tile + 1]++;
+			}
+			for (size_t tile = 1; tile < m_tileStart.size(); ++tile)
+				m_tileStart[tile] += m_tileStart[tile - 1];
+
+			m_tileFill.assign(m_tileStart.begin(), m_tileStart.end() - 1);
+			for (int i = 0; i < count; ++i)
+				m_sorted[m_tileFill[m_tileOf[i]]++] = m_droplets[i];
+
+			for (int color = 0; color < 4; ++color) {
+				m_colorTiles.clear();
+				for (int tz = color / 2; tz < tilesZ; tz += 2)
+					for (int tx = color % 2; tx < tilesX; tx += 2)
+						m_colorTiles.push_back(tz * tilesX + tx);
+
+				utils::ThreadPoolInstance::GetInstance()->parallelFor(0, m_colorTiles.size(), 1, [&](size_t first, size_t last) {
+					for (size_t i = first; i < last; ++i) {
+						const int tile = m_colorTiles[i];
+						for (int d = m_tileStart[tile]; d < m_tileStart[tile + 1]; ++d)
+							simulate(field, m_sorted[d]);
+					}
+				});
+			}
+
+			m_dropletsDone += count;
+		}
+
+		// Bilinear height at (x, z) and its gradient over the cell
+		static void sample(const Heightfield<float>& field, float x, float z, float& h, float& gradientX, float& gradientZ)
+		{
+			const int column = static_cast<int>(x);
+			const int row = static_cast<int>(z);
+			const float u = x - column;
+			const float v = z - row;
+
+			const float* heights = field.getRow(row) + column;
+			const float h00 = heights[0];
+			const float h10 = heights[1];
+			const float h01 = heights[field.getWidth()];
+			const float h11 = heights[field.getWidth() + 1];
+
+			gradientX = (h10 - h00) * (1 - v) + (h11 - h01) * v;
+			gradientZ = (h01 - h00) * (1 - u) + (h11 - h10) * u;
+			h = h00 * (1 - u) * (1 - v) + h10 * u * (1 - v) + h01 * (1 - u) * v + h11 * u * v;
+		}
+
+		void simulate(Heightfield<float>& field, Droplet droplet) const
+		{
+			const ErosionSettings& s = m_settings;
+			const int width = field.getWidth();
+			const int height = field.getHeight();
+			float* heights = field.getHeights();
+
+			float directionX = 0.f;
+			float directionZ = 0.f;
+			float speed = s.initialSpeed;
+			float water = s.initialWater;
+			float sediment = 0.f;
+
+			for (int step = 0; step < s.maxLifetime; ++step) {
+				const int column = static_cast<int>(droplet.x);
+				const int row = static_cast<int>(droplet.z);
+				const float u = droplet.x - column;
+				const float v = droplet.z - row;
+
+				float h, gradientX, gradientZ;
+				sample(field, droplet.x, droplet.z, h, gradientX, gradientZ);
+
+				directionX = directionX * s.inertia - gradientX * (1 - s.inertia);
+				directionZ = directionZ * s.inertia - gradientZ * (1 - s.inertia);
+				const float length = std::sqrt(directionX * directionX + directionZ * directionZ);
+				if (length < 1e-12f)
+					break;
+				directionX /= length;
+				directionZ /= length;
+
+				droplet.x += directionX;
+				droplet.z += directionZ;
+				if (droplet.x < 0 || droplet.z < 0 || droplet.x >= width - 1 || droplet.z >= height - 1)
+					break;
+
+				float newHeight, unusedX, unusedZ;
+				sample(field, droplet.x, droplet.z, newHeight, unusedX, unusedZ);
+				const float deltaHeight = newHeight - h;
+
+				const float capacity = std::max(-deltaHeight * speed * water * s.sedimentCapacity, s.minSedimentCapacity);
+
+				if (sediment > capacity || deltaHeight > 0) {
+					// uphill: fill the pit behind, otherwise drop the excess
+					const float amount = deltaHeight > 0 ? std::min(deltaHeight, sediment) : (sediment - capacity) * s.depositSpeed;
+					sediment -= amount;
+
+					float* cell = heights + field.index(column, row);
+					cell[0] += amount * (1 - u) * (1 - v);
+					cell[1] += amount * u * (1 - v);
+					cell[width] += amount * (1 - u) * v;
+					cell[width + 1] += amount * u * v;
+				}
+				else {
+					// never dig deeper than the drop, or the droplet would carve a pit
+					const float amount = std::min((capacity - sediment) * s.erodeSpeed, -deltaHeight);
+					for (const BrushSample& brush : m_brush) {
+						const int c = column + brush.dx;
+						const int r = row + brush.dz;
+						if (c < 0 || r < 0 || c >= width || r >= height)
+							continue;
+						heights[field.index(c, r)] -= amount * brush.weight;
+					}
+					sediment += amount;
+				}
+
+				speed = std::sqrt(std::max(speed * speed - deltaHeight * s.gravity, 0.f));
+				water *= 1 - s.evaporateSpeed;
+			}
+		}
+
+		ErosionSettings m_settings;
+		std::vector<BrushSample> m_brush;
+		int m_dropletsDone = 0;
+
+		std::vector<Droplet> m_droplets;
+		std::vector<Droplet> m_sorted;
+		std::vector<int> m_tileOf;
+		std::vector<int> m_tileStart;
+		std::vector<int> m_tileFill;
+		std::vector<int> m_colorTiles;
+	};
+
+}
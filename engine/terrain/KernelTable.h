@@ -0,0 +1,34 @@
+#pragma once
+
+#include "utils/math/Noise.h"
+#include "utils/math/NoiseGraph.h"
+#include "utils/math/RuntimeNoise.h"
+#include "utils/math/Simd.h"
+
+#include "engine/terrain/Kernels.h"
+#include "engine/terrain/NormalGenerator.h"
+#include "engine/terrain/ThermalErosion.h"
+
+// Shared by Kernels.cpp and the translation units built for one instruction set each
+// (KernelsAvx2.cpp, KernelsAvx512.cpp). Those must only instantiate templates of their
+// own backend: any other inline function they emitted would be compiled with their
+// flags, and could be the copy the linker keeps for the whole program.
+
+namespace terrain {
+
+	template<typename B>
+	Kernels makeKernels(simd::Isa isa)
+	{
+		return Kernels{
+			isa, &noise::fbmLine<B>, &gradientNormalSpan<B>, &thermalSpan<B>,
+			noise::RuntimeGraph::makeBackend<B>(),
+			&noise::evaluateLine<B, noise::presets::Hills>, &noise::evaluateLine<B, noise::presets::Mountains>
+		};
+	}
+
+	// Null when the compiler could not target the instruction set. Only called once the
+	// CPU is known to support it.
+	const Kernels* getAvx2Kernels();
+	const Kernels* getAvx512Kernels();
+
+}
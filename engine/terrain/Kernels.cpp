@@ -0,0 +1,63 @@
+#include "KernelTable.h"
+
+#include <cstdlib>
+#include <initializer_list>
+#include <iostream>
+
+namespace terrain {
+
+	namespace {
+
+		const Kernels* getBaselineKernels(simd::Isa isa)
+		{
+			static const Kernels scalar = makeKernels<simd::Scalar>(simd::Isa::Scalar);
+#if defined(TERRAIN_SIMD_SSE2)
+			static const Kernels sse2 = makeKernels<simd::Sse2>(simd::Isa::Sse2);
+			if (isa == simd::Isa::Sse2)
+				return &sse2;
+#endif
+			return isa == simd::Isa::Scalar ? &scalar : nullptr;
+		}
+
+		const Kernels& selectKernels()
+		{
+			if (const char* forced = std::getenv("TERRAIN_SIMD"); forced != nullptr && *forced != '\0') {
+				simd::Isa isa;
+				if (!simd::parseIsa(forced, isa))
+					std::cerr << "TERRAIN_SIMD: unknown instruction set " << forced << std::endl;
+				else if (const Kernels* kernels = findKernels(isa))
+					return *kernels;
+				else
+					std::cerr << "TERRAIN_SIMD: " << forced << " is not available on this machine or in this build" << std::endl;
+			}
+
+			for (simd::Isa isa : { simd::Isa::Avx512, simd::Isa::Avx2, simd::Isa::Sse2 })
+				if (const Kernels* kernels = findKernels(isa))
+					return *kernels;
+			return *findKernels(simd::Isa::Scalar);
+		}
+
+	}
+
+	const Kernels* findKernels(simd::Isa isa)
+	{
+		if (!simd::isSupported(isa))
+			return nullptr;
+
+		switch (isa) {
+		case simd::Isa::Avx512:
+			return getAvx512Kernels();
+		case simd::Isa::Avx2:
+			return getAvx2Kernels();
+		default:
+			return getBaselineKernels(isa);
+		}
+	}
+
+	const Kernels& getKernels()
+	{
+		static const Kernels& kernels = selectKernels();
+		return kernels;
+	}
+
+}
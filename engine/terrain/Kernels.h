@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "utils/math/CpuFeatures.h"
+#include "utils/math/Noise.h"
+#include "utils/math/NoiseGraph.h"
+#include "utils/math/RuntimeNoise.h"
+
+namespace terrain {
+
+	// The hot terrain kernels instantiated for one instruction set. Every entry is the
+	// template of the same name for that backend: the spans process whole vectors and
+	// return how many samples they did, fbmLine does the whole line. The noise graphs
+	// are here too: the block loops of runtime graphs, and evaluateLine for the
+	// production presets only, other compile-time graphs staying on simd::Native.
+	struct Kernels
+	{
+		simd::Isa isa;
+		void (*fbmLine)(const NoiseSettings& settings, float x0, float z0, float dx, float dz, std::size_t first, std::size_t count, float* out);
+		int (*gradientNormalSpan)(const float* left, const float* right, const float* up, const float* down, int count, float scaleX, float scaleZ, float* normalX, float* normalY, float* normalZ);
+		int (*thermalSpan)(const float* up, const float* center, const float* down, int count, float talus, float talusDiagonal, float rate, float* out);
+		noise::RuntimeGraph::Backend runtimeGraph;
+		void (*hillsLine)(const noise::presets::Hills& graph, std::uint32_t seed, float x0, float z0, float dx, float dz, std::size_t first, std::size_t count, float* out);
+		void (*mountainsLine)(const noise::presets::Mountains& graph, std::uint32_t seed, float x0, float z0, float dx, float dz, std::size_t first, std::size_t count, float* out);
+	};
+
+	// Kernels for isa, or null when the build or the CPU lacks it
+	const Kernels* findKernels(simd::Isa isa);
+
+	// Kernels of the widest instruction set available, chosen on the first call. The
+	// environment variable TERRAIN_SIMD (scalar, sse2, avx2 or avx512) forces one of
+	// the available sets, for testing.
+	const Kernels& getKernels();
+
+}
@@ -0,0 +1,16 @@
+// Compiled for AVX2 (see CMakeLists.txt)
+#include "KernelTable.h"
+
+namespace terrain {
+
+	const Kernels* getAvx2Kernels()
+	{
+#if defined(TERRAIN_SIMD_AVX2)
+		static const Kernels kernels = makeKernels<simd::Avx2>(simd::Isa::Avx2);
+		return &kernels;
+#else
+		return nullptr;
+#endif
+	}
+
+}
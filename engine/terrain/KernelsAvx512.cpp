@@ -0,0 +1,16 @@
+// Compiled for AVX-512 (see CMakeLists.txt)
+#include "KernelTable.h"
+
+namespace terrain {
+
+	const Kernels* getAvx512Kernels()
+	{
+#if defined(TERRAIN_SIMD_AVX512)
+		static const Kernels kernels = makeKernels<simd::Avx512>(simd::Isa::Avx512);
+		return &kernels;
+#else
+		return nullptr;
+#endif
+	}
+
+}
@@ -0,0 +1,287 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "utils/math/Frustum.h"
+#include "utils/threading/ThreadPool.h"
+
+#include "engine/terrain/ChunkGrid.h"
+#include "engine/terrain/Heightfield.h"
+#include "engine/terrain/Tiling.h"
+
+namespace terrain {
+
+	constexpr int MaxLodLevels = 8;
+
+	struct Aabb
+	{
+		float minX = 0.f;
+		float minY = 0.f;
+		float minZ = 0.f;
+		float maxX = 0.f;
+		float maxY = 0.f;
+		float maxZ = 0.f;
+	};
+
+	inline float distanceSquared(const Aabb& box, const Point3d<float>& p)
+	{
+		const float dx = std::max({ box.minX - p.x, 0.f, p.x - box.maxX });
+		const float dy = std::max({ box.minY - p.y, 0.f, p.y - box.maxY });
+		const float dz = std::max({ box.minZ - p.z, 0.f, p.z - box.maxZ });
+		return dx * dx + dy * dy + dz * dz;
+	}
+
+	struct LodSettings
+	{
+		// Distance up to which a level is drawn, in multiples of the size of its chunks.
+		// Must stay above 2 * sqrt(2) so that neighbouring nodes never differ by more
+		// than one level.
+		float rangeFactor = 4.f;
+
+		// Fraction of a level's range after which its vertices start morphing towards
+		// the next coarser level
+		float morphStartRatio = 0.7f;
+	};
+
+	// Continuous distance-dependent LOD over the terrain chunks (CDLOD).
+	//
+	// Level L samples the heightfield every 2^L samples and is cut into regular chunks,
+	// so a level L chunk covers the same ground as 2 x 2 chunks of level L - 1: these are
+	// the quadtree nodes. Every chunk of every level owns one slot of ChunkVertexCount
+	// vertices in the vertex buffer. Each frame, select() walks the tree from the
+	// coarsest level and splits the nodes closer to the camera than the range of the
+	// level below. Vertices morph towards the coarser level over the last part of their
+	// level's range, so a node is fully morphed where it meets a coarser neighbour:
+	// transitions neither pop nor crack.
+	//
+	// Given a frustum, select() also culls: the bounds of every slot are tested in one
+	// batched pass first, and the walk drops the nodes found outside.
+	class LodQuadtree
+	{
+	public:
+		struct Level
+		{
+			int stride = 1;		// heightfield samples between two vertices
+			int width = 0;		// vertices of the level along x
+			int height = 0;		// vertices of the level along z
+			ChunkGrid grid;
+			int firstSlot = 0;
+			float range = 0.f;
+			float morphStart = 0.f;
+		};
+
+		void build(const Heightfield<float>& field, const LodSettings& settings = LodSettings())
+		{
+			m_levels.clear();
+			m_slotLevels.clear();
+			m_slotChunks.clear();
+
+			int slotCount = 0;
+			for (int level = 0; level < MaxLodLevels; ++level) {
+				Level lod;
+				lod.stride = 1 << level;
+				lod.width = (field.getWidth() - 1 + lod.stride - 1) / lod.stride + 1;
+				lod.height = (field.getHeight() - 1 + lod.stride - 1) / lod.stride + 1;
+				lod.grid = ChunkGrid(lod.width, lod.height);
+				lod.firstSlot = slotCount;
+				lod.range = settings.rangeFactor * ChunkQuads * lod.stride * field.getSpacing();
+				lod.morphStart = lod.range * settings.morphStartRatio;
+
+				for (int chunk = 0; chunk < lod.grid.getChunkCount(); ++chunk) {
+					m_slotLevels.push_back(level);
+					m_slotChunks.push_back(chunk);
+				}
+				slotCount += lod.grid.getChunkCount();
+				m_levels.push_back(lod);
+
+				if (lod.grid.getChunkCount() == 1)
+					break;
+			}
+
+			// the coarsest level has nothing to morph to
+			m_levels.back().range = std::numeric_limits<float>::max();
+			m_levels.back().morphStart = std::numeric_limits<float>::max();
+
+			computeBounds(field);
+		}
+
+		int getLevelCount() const { return static_cast<int>(m_levels.size()); }
+		const Level& getLevel(int level) const { return m_levels[level]; }
+
+		int getSlotCount() const { return static_cast<int>(m_slotLevels.size()); }
+		int getSlotLevel(int slot) const { return m_slotLevels[slot]; }
+		int getSlotChunk(int slot) const { return m_slotChunks[slot]; }
+		const Aabb& getSlotBounds(int slot) const { return m_bounds[slot]; }
+
+		// Samples read by the slot: its vertices, ChunkQuads * stride + 1 along each side
+		TileRect getSlotRect(int slot) const
+		{
+			const int stride = m_levels[m_slotLevels[slot]].stride;
+			const int firstColumn = getSlotFirstColumn(slot);
+			const int firstRow = getSlotFirstRow(slot);
+			return { firstColumn, firstColumn + ChunkQuads * stride + 1, firstRow, firstRow + ChunkQuads * stride + 1 };
+		}
+
+		// Recomputes the height bounds of the slots covering region, after its heights changed
+		void updateBounds(const Heightfield<float>& field, const TileRect& region)
+		{
+			// levels in order: a coarse box is the union of its children
+			for (int slot = 0; slot < getSlotCount(); ++slot) {
+				if (!getSlotRect(slot).overlaps(region))
+					continue;
+
+				computeSlotBounds(field, slot);
+				const Aabb& box = m_bounds[slot];
+				m_boxes.set(slot, box.minX, box.minY, box.minZ, box.maxX, box.maxY, box.maxZ);
+			}
+		}
+
+		// First heightfield sample covered by the slot
+		int getSlotFirstColumn(int slot) const
+		{
+			const Level& level = m_levels[m_slotLevels[slot]];
+			return level.grid.getFirstColumn(m_slotChunks[slot]) * level.stride;
+		}
+
+		int getSlotFirstRow(int slot) const
+		{
+			const Level& level = m_levels[m_slotLevels[slot]];
+			return level.grid.getFirstRow(m_slotChunks[slot]) * level.stride;
+		}
+
+		// Fills out with the slots to draw for a camera at cameraPosition (map space)
+		void select(const Point3d<float>& cameraPosition, std::vector<int>& out)
+		{
+			m_visible.assign(getSlotCount(), 1);
+			selectVisible(cameraPosition, out);
+		}
+
+		// Same, skipping the nodes outside frustum (map space planes)
+		void select(const Point3d<float>& cameraPosition, const Frustum& frustum, std::vector<int>& out)
+		{
+			frustum.cull(m_boxes, m_visible);
+			selectVisible(cameraPosition, out);
+		}
+
+		// Nodes drawn and nodes dropped by the frustum during the last select()
+		int getVisibleCount() const { return m_visibleCount; }
+		int getCulledCount() const { return m_culledCount; }
+
+	private:
+		void selectVisible(const Point3d<float>& cameraPosition, std::vector<int>& out)
+		{
+			out.clear();
+			m_culledCount = 0;
+
+			const int top = getLevelCount() - 1;
+			for (int chunkZ = 0; chunkZ < m_levels[top].grid.getChunksZ(); ++chunkZ)
+				for (int chunkX = 0; chunkX < m_levels[top].grid.getChunksX(); ++chunkX)
+					selectNode(top, chunkX, chunkZ, cameraPosition, out);
+
+			m_visibleCount = static_cast<int>(out.size());
+		}
+
+		void selectNode(int level, int chunkX, int chunkZ, const Point3d<float>& cameraPosition, std::vector<int>& out)
+		{
+			const Level& lod = m_levels[level];
+			if (chunkX >= lod.grid.getChunksX() || chunkZ >= lod.grid.getChunksZ())
+				return;
+
+			const int slot = lod.firstSlot + chunkZ * lod.grid.getChunksX() + chunkX;
+			if (!m_visible[slot]) {
+				++m_culledCount;
+				return;
+			}
+
+			const float childRange = level > 0 ? m_levels[level - 1].range : 0.f;
+
+			if (level > 0 && distanceSquared(m_bounds[slot], cameraPosition) < childRange * childRange) {
+				for (int child = 0; child < 4; ++child)
+					selectNode(level - 1, chunkX * 2 + (child & 1), chunkZ * 2 + (child >> 1), cameraPosition, out);
+				return;
+			}
+
+			out.push_back(slot);
+		}
+
+		// Level 0 bounds come from the heightfield, coarser ones from their children
+		void computeBounds(const Heightfield<float>& field)
+		{
+			m_bounds.assign(getSlotCount(), Aabb());
+
+			for (int level = 0; level < getLevelCount(); ++level) {
+				const Level& lod = m_levels[level];
+
+				utils::ThreadPoolInstance::GetInstance()->parallelFor(0, lod.grid.getChunkCount(), 4, [&](size_t first, size_t last) {
+					for (int chunk = static_cast<int>(first); chunk < static_cast<int>(last); ++chunk)
+						computeSlotBounds(field, lod.firstSlot + chunk);
+				});
+			}
+
+			m_boxes.resize(m_bounds.size());
+			for (size_t slot = 0; slot < m_bounds.size(); ++slot) {
+				const Aabb& box = m_bounds[slot];
+				m_boxes.set(slot, box.minX, box.minY, box.minZ, box.maxX, box.maxY, box.maxZ);
+			}
+		}
+
+		void computeSlotBounds(const Heightfield<float>& field, int slot)
+		{
+			const int level = m_slotLevels[slot];
+			const int chunk = m_slotChunks[slot];
+			const Level& lod = m_levels[level];
+			const int firstColumn = getSlotFirstColumn(slot);
+			const int firstRow = getSlotFirstRow(slot);
+			const int lastColumn = std::min(firstColumn + ChunkQuads * lod.stride, field.getWidth() - 1);
+			const int lastRow = std::min(firstRow + ChunkQuads * lod.stride, field.getHeight() - 1);
+
+			Aabb& box = m_bounds[slot];
+			box.minX = field.getX(firstColumn);
+			box.maxX = field.getX(lastColumn);
+			box.minZ = field.getZ(firstRow);
+			box.maxZ = field.getZ(lastRow);
+			box.minY = std::numeric_limits<float>::max();
+			box.maxY = std::numeric_limits<float>::lowest();
+
+			if (level == 0) {
+				for (int row = firstRow; row <= lastRow; ++row) {
+					const float* heights = field.getRow(row);
+					for (int column = firstColumn; column <= lastColumn; ++column) {
+						box.minY = std::min(box.minY, heights[column]);
+						box.maxY = std::max(box.maxY, heights[column]);
+					}
+				}
+				return;
+			}
+
+			const Level& below = m_levels[level - 1];
+			const int chunkX = chunk % lod.grid.getChunksX();
+			const int chunkZ = chunk / lod.grid.getChunksX();
+			for (int child = 0; child < 4; ++child) {
+				const int childX = chunkX * 2 + (child & 1);
+				const int childZ = chunkZ * 2 + (child >> 1);
+				if (childX >= below.grid.getChunksX() || childZ >= below.grid.getChunksZ())
+					continue;
+
+				const Aabb& childBox = m_bounds[below.firstSlot + childZ * below.grid.getChunksX() + childX];
+				box.minY = std::min(box.minY, childBox.minY);
+				box.maxY = std::max(box.maxY, childBox.maxY);
+			}
+		}
+
+		std::vector<Level> m_levels;
+		std::vector<int> m_slotLevels;
+		std::vector<int> m_slotChunks;
+		std::vector<Aabb> m_bounds;
+
+		// m_bounds again, laid out for the batched frustum test
+		AabbBatch m_boxes;
+		std::vector<std::uint8_t> m_visible;
+		int m_visibleCount = 0;
+		int m_culledCount = 0;
+	};
+
+}
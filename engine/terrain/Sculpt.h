@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "utils/math/Math.h"
+
+#include "engine/terrain/Heightfield.h"
+#include "engine/terrain/Tiling.h"
+
+namespace terrain {
+
+	enum class BrushMode
+	{
+		Raise,
+		Lower,
+		Smooth,
+		Flatten
+	};
+
+	// Distances in heightfield units, strength per second
+	struct Brush
+	{
+		BrushMode mode = BrushMode::Raise;
+		float radius = 0.5f;
+		float strength = 0.5f;      // height per second for Raise / Lower, blend rate otherwise
+		float targetHeight = 0.f;   // Flatten: usually the height under the brush when the stroke started
+	};
+
+	// Bilinear height at (x, z), clamped to the grid
+	inline float sampleHeight(const Heightfield<float>& field, float x, float z)
+	{
+		const float column = std::clamp((x - field.getOriginX()) / field.getSpacing(), 0.f, static_cast<float>(field.getWidth() - 1));
+		const float row = std::clamp((z - field.getOriginZ()) / field.getSpacing(), 0.f, static_cast<float>(field.getHeight() - 1));
+		const int c0 = std::min(static_cast<int>(column), field.getWidth() - 2);
+		const int r0 = std::min(static_cast<int>(row), field.getHeight() - 2);
+		const float u = column - c0;
+		const float v = row - r0;
+
+		const float top = field.at(c0, r0) + (field.at(c0 + 1, r0) - field.at(c0, r0)) * u;
+		const float bottom = field.at(c0, r0 + 1) + (field.at(c0 + 1, r0 + 1) - field.at(c0, r0 + 1)) * u;
+		return top + (bottom - top) * v;
+	}
+
+	// First point where the ray from origin along direction goes under the terrain,
+	// within maxDistance. Marches half a sample at a time, then bisects the last step.
+	inline bool raycast(const Heightfield<float>& field, const Point3d<float>& origin, const Point3d<float>& direction, float maxDistance, Point3d<float>& hit)
+	{
+		const float length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+		if (length <= 0.f || field.getWidth() < 2 || field.getHeight() < 2)
+			return false;
+
+		const Point3d<float> step(direction.x / length, direction.y / length, direction.z / length);
+		auto pointAt = [&](float t) { return Point3d<float>(origin.x + step.x * t, origin.y + step.y * t, origin.z + step.z * t); };
+		auto isInside = [&](const Point3d<float>& p) {
+			return p.x >= field.getOriginX() && p.z >= field.getOriginZ() && p.x <= field.getX(field.getWidth() - 1) && p.z <= field.getZ(field.getHeight() - 1);
+		};
+		auto isBelow = [&](const Point3d<float>& p) { return isInside(p) && p.y <= sampleHeight(field, p.x, p.z); };
+
+		const float increment = 0.5f * field.getSpacing();
+		float previous = 0.f;
+		for (float t = 0.f; t <= maxDistance; t += increment) {
+			if (isBelow(pointAt(t))) {
+				float above = previous;
+				float below = t;
+				for (int i = 0; i < 16; ++i) {
+					const float middle = 0.5f * (above + below);
+					(isBelow(pointAt(middle)) ? below : above) = middle;
+				}
+				hit = pointAt(below);
+				return true;
+			}
+			previous = t;
+		}
+		return false;
+	}
+
+	// Applies the brush centered on (x, z) for deltaTime seconds and returns the samples
+	// it changed. Smoothing reads a copy of the footprint and a one-sample border, so the
+	// result does not depend on the order the samples are visited in.
+	inline TileRect applyBrush(Heightfield<float>& field, const Brush& brush, float x, float z, float deltaTime)
+	{
+		const float spacing = field.getSpacing();
+		const float centerColumn = (x - field.getOriginX()) / spacing;
+		const float centerRow = (z - field.getOriginZ()) / spacing;
+		const float radius = brush.radius / spacing;
+
+		const TileRect footprint = TileRect{
+			static_cast<int>(std::floor(centerColumn - radius)), static_cast<int>(std::ceil(centerColumn + radius)) + 1,
+			static_cast<int>(std::floor(centerRow - radius)), static_cast<int>(std::ceil(centerRow + radius)) + 1
+		}.expanded(0, field.getWidth(), field.getHeight());
+		if (footprint.isEmpty() || radius <= 0.f)
+			return {};
+
+		// smoothing averages the 3 x 3 neighbourhood of the heights before this call
+		const TileRect source = footprint.expanded(1, field.getWidth(), field.getHeight());
+		const int sourceWidth = source.columnEnd - source.columnBegin;
+		std::vector<float> before;
+		if (brush.mode == BrushMode::Smooth) {
+			before.resize(static_cast<size_t>(sourceWidth) * (source.rowEnd - source.rowBegin));
+			for (int row = source.rowBegin; row < source.rowEnd; ++row)
+				std::copy(field.getRow(row) + source.columnBegin, field.getRow(row) + source.columnEnd, before.begin() + static_cast<size_t>(row - source.rowBegin) * sourceWidth);
+		}
+		auto beforeAt = [&](int column, int row) {
+			column = std::clamp(column, source.columnBegin, source.columnEnd - 1);
+			row = std::clamp(row, source.rowBegin, source.rowEnd - 1);
+			return before[static_cast<size_t>(row - source.rowBegin) * sourceWidth + column - source.columnBegin];
+		};
+
+		const float amount = brush.strength * deltaTime;
+		for (int row = footprint.rowBegin; row < footprint.rowEnd; ++row) {
+			float* heights = field.getRow(row);
+			for (int column = footprint.columnBegin; column < footprint.columnEnd; ++column) {
+				const float dx = column - centerColumn;
+				const float dz = row - centerRow;
+				const float distance = (dx * dx + dz * dz) / (radius * radius);
+				if (distance >= 1.f)
+					continue;
+
+				// smooth falloff, 1 at the center and flat at the rim
+				const float weight = (1.f - distance) * (1.f - distance);
+				float& height = heights[column];
+
+				switch (brush.mode) {
+				case BrushMode::Raise:
+					height += amount * weight;
+					break;
+				case BrushMode::Lower:
+					height -= amount * weight;
+					break;
+				case BrushMode::Smooth: {
+					float sum = 0.f;
+					for (int r = row - 1; r <= row + 1; ++r)
+						for (int c = column - 1; c <= column + 1; ++c)
+							sum += beforeAt(c, r);
+					height += (sum / 9.f - height) * std::min(amount * weight, 1.f);
+					break;
+				}
+				case BrushMode::Flatten:
+					height += (brush.targetHeight - height) * std::min(amount * weight, 1.f);
+					break;
+				}
+			}
+		}
+		return footprint;
+	}
+
+}
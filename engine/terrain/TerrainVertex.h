@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "engine/terrain/ChunkGrid.h"
+#include "engine/terrain/Heightfield.h"
+
+namespace terrain {
+
+	// 8-byte GPU vertex. x and z are not stored: map.vert rebuilds them from gl_VertexID,
+	// the vertex position inside its chunk. Heights are quantized to 16 bits over the
+	// terrain height range; morphHeight is the height of the next coarser LOD level at
+	// the same x and z. The normal is octahedral-encoded around the y axis and quantized
+	// to two signed normalized 16-bit values.
+	struct TerrainVertex
+	{
+		std::uint16_t height;
+		std::uint16_t morphHeight;
+		std::int16_t normal[2];
+	};
+	static_assert(sizeof(TerrainVertex) == 8, "TerrainVertex must stay tightly packed");
+
+	// Maps [minimum, minimum + extent] onto the 16-bit unsigned normalized range
+	struct HeightQuantizer
+	{
+		float minimum = 0.f;
+		float extent = 1.f;
+
+		std::uint16_t quantize(float height) const
+		{
+			return static_cast<std::uint16_t>(std::lround(std::clamp((height - minimum) / extent, 0.f, 1.f) * 65535.f));
+		}
+
+		float dequantize(std::uint16_t value) const
+		{
+			return minimum + value / 65535.f * extent;
+		}
+	};
+
+	inline HeightQuantizer computeHeightRange(const Heightfield<float>& field)
+	{
+		const auto [lowest, highest] = std::minmax_element(field.getHeights(), field.getHeights() + field.getSampleCount());
+
+		HeightQuantizer quantizer;
+		quantizer.minimum = *lowest;
+		quantizer.extent = std::max(*highest - *lowest, 1e-6f);
+		return quantizer;
+	}
+
+	inline std::int16_t toSnorm16(float value)
+	{
+		return static_cast<std::int16_t>(std::lround(std::clamp(value, -1.f, 1.f) * 32767.f));
+	}
+
+	// Projects the unit vector on the octahedron |x| + |y| + |z| = 1, then unfolds the
+	// lower half (y < 0) onto the corners of the xz square
+	inline void encodeOctahedral(float x, float y, float z, std::int16_t* out)
+	{
+		const float l1 = std::abs(x) + std::abs(y) + std::abs(z);
+		float u = x / l1;
+		float v = z / l1;
+
+		if (y < 0.f) {
+			const float foldedU = (1.f - std::abs(v)) * (u >= 0.f ? 1.f : -1.f);
+			const float foldedV = (1.f - std::abs(u)) * (v >= 0.f ? 1.f : -1.f);
+			u = foldedU;
+			v = foldedV;
+		}
+
+		out[0] = toSnorm16(u);
+		out[1] = toSnorm16(v);
+	}
+
+	// CPU mirror of octDecode in map.vert
+	inline Point3d<float> decodeOctahedral(const std::int16_t* in)
+	{
+		const float u = std::max(in[0] / 32767.f, -1.f);
+		const float v = std::max(in[1] / 32767.f, -1.f);
+
+		Point3d<float> n(u, 1.f - std::abs(u) - std::abs(v), v);
+		if (n.y < 0.f) {
+			n.x = (1.f - std::abs(v)) * (u >= 0.f ? 1.f : -1.f);
+			n.z = (1.f - std::abs(u)) * (v >= 0.f ? 1.f : -1.f);
+		}
+		return n / std::sqrt((n.x * n.x) + (n.y * n.y) + (n.z * n.z));
+	}
+
+	// Writes the ChunkVertexCount vertices of the chunk whose first vertex is the sample
+	// (firstColumn, firstRow), taking every stride-th sample, row after row. Vertices
+	// past the field edges repeat the last column or row.
+	//
+	// The morph height lies on the surface of the grid sampled every 2 * stride: equal
+	// to the height on even rows and columns of the chunk, the middle of the coarse edge
+	// otherwise. Coarse quads use the same diagonal as the strips, from (c - 1, r + 1)
+	// to (c + 1, r - 1).
+	inline void packChunkAt(const Heightfield<float>& field, int firstColumn, int firstRow, int stride, const HeightQuantizer& quantizer, TerrainVertex* out)
+	{
+		auto sampleIndex = [&](int localColumn, int localRow) {
+			return field.index(std::min(firstColumn + localColumn * stride, field.getWidth() - 1), std::min(firstRow + localRow * stride, field.getHeight() - 1));
+		};
+		auto heightAt = [&](int localColumn, int localRow) {
+			return field.getHeights()[sampleIndex(localColumn, localRow)];
+		};
+
+		for (int row = 0; row < ChunkVertices; ++row) {
+			for (int column = 0; column < ChunkVertices; ++column) {
+				const size_t i = sampleIndex(column, row);
+				const float height = field.getHeights()[i];
+
+				float morphHeight = height;
+				if (column % 2 == 1 && row % 2 == 1)
+					morphHeight = 0.5f * (heightAt(column - 1, row + 1) + heightAt(column + 1, row - 1));
+				else if (column % 2 == 1)
+					morphHeight = 0.5f * (heightAt(column - 1, row) + heightAt(column + 1, row));
+				else if (row % 2 == 1)
+					morphHeight = 0.5f * (heightAt(column, row - 1) + heightAt(column, row + 1));
+
+				TerrainVertex& vertex = out[row * ChunkVertices + column];
+				vertex.height = quantizer.quantize(height);
+				vertex.morphHeight = quantizer.quantize(morphHeight);
+				encodeOctahedral(field.getNormalsX()[i], field.getNormalsY()[i], field.getNormalsZ()[i], vertex.normal);
+			}
+		}
+	}
+
+	// Chunk of a grid sampling the heightfield every stride samples. Chunks start on
+	// even grid columns and rows, so the chunk-local parity used for morphing is the
+	// parity in the level grid.
+	inline void packChunk(const Heightfield<float>& field, const ChunkGrid& grid, int chunk, int stride, const HeightQuantizer& quantizer, TerrainVertex* out)
+	{
+		packChunkAt(field, grid.getFirstColumn(chunk) * stride, grid.getFirstRow(chunk) * stride, stride, quantizer, out);
+	}
+
+}
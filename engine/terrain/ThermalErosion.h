@@ -0,0 +1,296 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "utils/math/Simd.h"
+#include "utils/threading/ThreadPool.h"
+
+#include "engine/terrain/Heightfield.h"
+#include "engine/terrain/Kernels.h"
+#include "engine/terrain/Tiling.h"
+
+namespace terrain {
+
+	struct ThermalSettings
+	{
+		float talus = 0.7f;         // steepest stable slope, height over horizontal distance
+		float rate = 0.05f;         // share of the excess moved to each neighbour per step, at most 1/16
+		int tileSize = 128;
+		int stepsPerPass = 8;       // steps run on a tile between two syncs, also its halo depth
+	};
+
+	// One step of the thermal stencil on count consecutive samples, B::width at a time.
+	// Returns how many were done. up, center and down are the rows around the samples.
+	//
+	// Between a sample and each of its 8 neighbours, rate times the height difference
+	// beyond the talus flows downhill. The flow between two samples is computed the
+	// same way from both sides, so the material is conserved.
+	template<typename B>
+	int thermalSpan(const float* up, const float* center, const float* down, int count, float talus, float talusDiagonal, float rate, float* out)
+	{
+		using Float = typename B::Float;
+
+		const Float zero = B::broadcast(0.f);
+		const Float straight = B::broadcast(talus);
+		const Float diagonal = B::broadcast(talusDiagonal);
+		const Float negativeStraight = B::broadcast(-talus);
+		const Float negativeDiagonal = B::broadcast(-talusDiagonal);
+		const Float k = B::broadcast(rate);
+
+		int i = 0;
+		for (; i + B::width <= count; i += B::width) {
+			const Float h = B::load(center + i);
+
+			// inflow from higher neighbours, outflow to lower ones
+			auto flow = [&](Float flux, const float* neighbour, Float positive, Float negative) {
+				const Float d = B::sub(B::load(neighbour), h);
+				return B::add(flux, B::add(B::max(B::sub(d, positive), zero), B::min(B::sub(d, negative), zero)));
+			};
+
+			Float flux = zero;
+			flux = flow(flux, up + i - 1, diagonal, negativeDiagonal);
+			flux = flow(flux, up + i, straight, negativeStraight);
+			flux = flow(flux, up + i + 1, diagonal, negativeDiagonal);
+			flux = flow(flux, center + i - 1, straight, negativeStraight);
+			flux = flow(flux, center + i + 1, straight, negativeStraight);
+			flux = flow(flux, down + i - 1, diagonal, negativeDiagonal);
+			flux = flow(flux, down + i, straight, negativeStraight);
+			flux = flow(flux, down + i + 1, diagonal, negativeDiagonal);
+
+			B::store(out + i, B::add(h, B::mul(flux, k)));
+		}
+		return i;
+	}
+
+	// Thermal erosion: material slides down every slope steeper than the talus until
+	// it rests at it. Samples past the edge of the field repeat the edge.
+	//
+	// Each pass runs up to stepsPerPass steps tile by tile. A tile copies itself and a
+	// halo of stepsPerPass samples into a small per-thread buffer pair, steps there (the
+	// valid area shrinks by one sample per step) and writes its interior to a second
+	// plane, swapped in at the end of the pass. The buffers stay in cache for all the
+	// steps, and tiles run in parallel since they only read the previous plane.
+	//
+	// Tiles that did not change, next to tiles that did not change either, cannot change
+	// in the next pass and are only copied. The tiles changed since clearDirtyTiles() are
+	// reported so normals and vertex buffers can be refreshed locally.
+	class ThermalErosion
+	{
+	public:
+		explicit ThermalErosion(const ThermalSettings& settings = ThermalSettings())
+			: m_settings(settings)
+		{
+			m_settings.rate = std::clamp(m_settings.rate, 0.f, 1.f / 16.f);
+			m_settings.tileSize = std::max(m_settings.tileSize, 8);
+			m_settings.stepsPerPass = std::clamp(m_settings.stepsPerPass, 1, m_settings.tileSize);
+		}
+
+		const ThermalSettings& getSettings() const { return m_settings; }
+
+		void run(Heightfield<float>& field, int iterations)
+		{
+			prepare(field);
+			while (iterations > 0) {
+				const int steps = std::min(iterations, m_settings.stepsPerPass);
+				runPass(field, steps);
+				iterations -= steps;
+			}
+		}
+
+		// Heights of region were edited elsewhere: its tiles must be computed again
+		void invalidate(const TileRect& region)
+		{
+			for (int tile = 0; tile < getTileCount(); ++tile)
+				if (getTileRect(tile).overlaps(region))
+					m_changed[tile] = 1;
+		}
+
+		// Tiles whose heights changed since the last clearDirtyTiles()
+		std::vector<TileRect> getDirtyTiles() const
+		{
+			std::vector<TileRect> tiles;
+			for (int tile = 0; tile < getTileCount(); ++tile)
+				if (m_dirty[tile])
+					tiles.push_back(getTileRect(tile));
+			return tiles;
+		}
+
+		void clearDirtyTiles()
+		{
+			std::fill(m_dirty.begin(), m_dirty.end(), std::uint8_t(0));
+		}
+
+		// Tiles stepped, rather than copied, by the last pass
+		int getActiveTileCount() const { return m_activeCount; }
+		int getTileCount() const { return m_tilesX * m_tilesZ; }
+
+	private:
+		TileRect getTileRect(int tile) const
+		{
+			const int tileSize = m_settings.tileSize;
+			const int columnBegin = (tile % m_tilesX) * tileSize;
+			const int rowBegin = (tile / m_tilesX) * tileSize;
+			return { columnBegin, std::min(columnBegin + tileSize, m_width), rowBegin, std::min(rowBegin + tileSize, m_height) };
+		}
+
+		// Sizes the second plane and the tile flags, and starts over with every tile
+		// active when the field is not the one of the previous run
+		void prepare(Heightfield<float>& field)
+		{
+			if (field.getWidth() == m_width && field.getHeight() == m_height && m_buffer.size() == field.getSampleCount())
+				return;
+
+			m_width = field.getWidth();
+			m_height = field.getHeight();
+			m_tilesX = (m_width + m_settings.tileSize - 1) / m_settings.tileSize;
+			m_tilesZ = (m_height + m_settings.tileSize - 1) / m_settings.tileSize;
+			m_buffer.assign(field.getSampleCount(), 0.f);
+			m_changed.assign(getTileCount(), 1);
+			m_nextChanged.assign(getTileCount(), 0);
+			m_dirty.assign(getTileCount(), 0);
+			m_lastSteps = 0;
+		}
+
+		bool isActive(int tile) const
+		{
+			const int tileX = tile % m_tilesX;
+			const int tileZ = tile / m_tilesX;
+			for (int z = std::max(tileZ - 1, 0); z <= std::min(tileZ + 1, m_tilesZ - 1); ++z)
+				for (int x = std::max(tileX - 1, 0); x <= std::min(tileX + 1, m_tilesX - 1); ++x)
+					if (m_changed[z * m_tilesX + x])
+						return true;
+			return false;
+		}
+
+		void runPass(Heightfield<float>& field, int steps)
+		{
+			// a tile at rest for n steps may still move over a different number of steps
+			if (steps != m_lastSteps)
+				std::fill(m_changed.begin(), m_changed.end(), std::uint8_t(1));
+			m_lastSteps = steps;
+
+			const float* source = field.getHeights();
+			float* destination = m_buffer.data();
+
+			std::vector<std::uint8_t> active(getTileCount());
+			m_activeCount = 0;
+			for (int tile = 0; tile < getTileCount(); ++tile) {
+				active[tile] = isActive(tile);
+				m_activeCount += active[tile];
+			}
+
+			utils::ThreadPoolInstance::GetInstance()->parallelFor(0, getTileCount(), 1, [&](size_t first, size_t last) {
+				for (int tile = static_cast<int>(first); tile < static_cast<int>(last); ++tile) {
+					const TileRect rect = getTileRect(tile);
+					if (!active[tile]) {
+						for (int row = rect.rowBegin; row < rect.rowEnd; ++row) {
+							const size_t offset = static_cast<size_t>(row) * m_width + rect.columnBegin;
+							std::memcpy(destination + offset, source + offset, (rect.columnEnd - rect.columnBegin) * sizeof(float));
+						}
+						m_nextChanged[tile] = 0;
+						continue;
+					}
+					m_nextChanged[tile] = stepTile(field.getSpacing(), source, destination, rect, steps);
+				}
+			});
+
+			field.swapHeights(m_buffer);
+			for (int tile = 0; tile < getTileCount(); ++tile) {
+				m_changed[tile] = m_nextChanged[tile];
+				m_dirty[tile] |= m_nextChanged[tile];
+			}
+		}
+
+		// Steps rect with its halo in the thread's buffers, writes its interior to
+		// destination and returns whether any of its samples changed
+		bool stepTile(float spacing, const float* source, float* destination, const TileRect& rect, int steps) const
+		{
+			thread_local std::vector<float> t_front;
+			thread_local std::vector<float> t_back;
+
+			const int halo = steps;
+			const int localWidth = rect.columnEnd - rect.columnBegin + 2 * halo;
+			const int localHeight = rect.rowEnd - rect.rowBegin + 2 * halo;
+			const int firstColumn = rect.columnBegin - halo;
+			const int firstRow = rect.rowBegin - halo;
+			t_front.resize(static_cast<size_t>(localWidth) * localHeight);
+			t_back.resize(t_front.size());
+
+			// local column of the field edges, for the samples past them
+			const int leftEdge = std::max(-firstColumn, 0);
+			const int rightEdge = std::min(m_width - 1 - firstColumn, localWidth - 1);
+			const int topEdge = std::max(-firstRow, 0);
+			const int bottomEdge = std::min(m_height - 1 - firstRow, localHeight - 1);
+
+			for (int row = 0; row < localHeight; ++row) {
+				const float* in = source + static_cast<size_t>(std::clamp(firstRow + row, 0, m_height - 1)) * m_width;
+				float* out = t_front.data() + static_cast<size_t>(row) * localWidth;
+				std::memcpy(out + leftEdge, in + firstColumn + leftEdge, (rightEdge - leftEdge + 1) * sizeof(float));
+				std::fill(out, out + leftEdge, in[0]);
+				std::fill(out + rightEdge + 1, out + localWidth, in[m_width - 1]);
+			}
+
+			const float talus = m_settings.talus * spacing;
+			const float talusDiagonal = talus * std::sqrt(2.f);
+			const bool clamped = leftEdge > 0 || topEdge > 0 || rightEdge < localWidth - 1 || bottomEdge < localHeight - 1;
+			const auto span = getKernels().thermalSpan;
+
+			for (int step = 1; step <= steps; ++step) {
+				const int first = step;
+				const int last = localWidth - step;
+
+				for (int row = step; row < localHeight - step; ++row) {
+					const float* center = t_front.data() + static_cast<size_t>(row) * localWidth;
+					float* out = t_back.data() + static_cast<size_t>(row) * localWidth;
+
+					const int done = first + span(center - localWidth + first, center + first, center + localWidth + first, last - first, talus, talusDiagonal, m_settings.rate, out + first);
+					thermalSpan<simd::Scalar>(center - localWidth + done, center + done, center + localWidth + done, last - done, talus, talusDiagonal, m_settings.rate, out + done);
+				}
+
+				// the samples past the edges follow the edge again
+				if (clamped) {
+					for (int row = step; row < localHeight - step; ++row) {
+						float* out = t_back.data() + static_cast<size_t>(row) * localWidth;
+						std::fill(out + first, out + std::max(leftEdge, first), out[leftEdge]);
+						std::fill(out + std::min(rightEdge + 1, last), out + last, out[rightEdge]);
+					}
+					for (int row = step; row < topEdge; ++row)
+						std::memcpy(t_back.data() + static_cast<size_t>(row) * localWidth, t_back.data() + static_cast<size_t>(topEdge) * localWidth, localWidth * sizeof(float));
+					for (int row = bottomEdge + 1; row < localHeight - step; ++row)
+						std::memcpy(t_back.data() + static_cast<size_t>(row) * localWidth, t_back.data() + static_cast<size_t>(bottomEdge) * localWidth, localWidth * sizeof(float));
+				}
+
+				t_front.swap(t_back);
+			}
+
+			bool changed = false;
+			const size_t rowBytes = (rect.columnEnd - rect.columnBegin) * sizeof(float);
+			for (int row = rect.rowBegin; row < rect.rowEnd; ++row) {
+				const float* local = t_front.data() + static_cast<size_t>(row - firstRow) * localWidth + halo;
+				const size_t offset = static_cast<size_t>(row) * m_width + rect.columnBegin;
+				changed = changed || std::memcmp(local, source + offset, rowBytes) != 0;
+				std::memcpy(destination + offset, local, rowBytes);
+			}
+			return changed;
+		}
+
+		ThermalSettings m_settings;
+		int m_width = 0;
+		int m_height = 0;
+		int m_tilesX = 0;
+		int m_tilesZ = 0;
+		int m_lastSteps = 0;
+		int m_activeCount = 0;
+
+		Heightfield<float>::Plane m_buffer;
+		std::vector<std::uint8_t> m_changed;       // by the last pass
+		std::vector<std::uint8_t> m_nextChanged;
+		std::vector<std::uint8_t> m_dirty;         // since clearDirtyTiles()
+	};
+
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#include "utils/io/MappedFile.h"
+#include "utils/math/CpuFeatures.h"
+#include "utils/math/Noise.h"
+
+#include "engine/terrain/ChunkGrid.h"
+#include "engine/terrain/LodQuadtree.h"
+#include "engine/terrain/TerrainVertex.h"
+
+namespace terrain {
+
+	constexpr std::uint32_t TileMagic = 0x4c545254;	// "TRTL" read as little endian bytes
+	constexpr std::uint32_t TileVersion = 1;
+
+	// A cached chunk file is this header followed by the ChunkVertexCount vertices,
+	// exactly as they go to the vertex buffer. Everything is fixed size and native
+	// endian, so a mapped file is used in place.
+	struct TileHeader
+	{
+		std::uint32_t magic = TileMagic;
+		std::uint32_t version = TileVersion;
+		std::uint64_t generatorHash = 0;
+		std::int32_t level = 0;
+		std::int32_t x = 0;
+		std::int32_t z = 0;
+		std::uint32_t vertexCount = ChunkVertexCount;
+		float bounds[6] = {};
+		std::uint32_t reserved[2] = {};
+	};
+	static_assert(sizeof(TileHeader) == 64, "TileHeader is part of the file format");
+	static_assert(sizeof(TileHeader) % alignof(TerrainVertex) == 0, "vertices must stay aligned after the header");
+
+	// 64-bit FNV-1a over the values fed one by one, never over raw structs, so padding
+	// never leaks into the key
+	class GeneratorHash
+	{
+	public:
+		template<typename T>
+		GeneratorHash& add(const T& value)
+		{
+			unsigned char bytes[sizeof(T)];
+			std::memcpy(bytes, &value, sizeof(T));
+			for (unsigned char byte : bytes) {
+				m_hash ^= byte;
+				m_hash *= 0x100000001b3ull;
+			}
+			return *this;
+		}
+
+		std::uint64_t get() const { return m_hash; }
+
+	private:
+		std::uint64_t m_hash = 0xcbf29ce484222325ull;
+	};
+
+	// Everything that changes the bytes of a generated chunk. isa is the instruction set
+	// of the kernels: the vector normals use an approximate reciprocal square root,
+	// whose last bits differ from one set to another.
+	inline std::uint64_t hashGenerator(const NoiseSettings& noise, float spacing, float baseHeight, const HeightQuantizer& quantizer, simd::Isa isa)
+	{
+		return GeneratorHash()
+			.add(TileVersion).add(ChunkQuads).add(static_cast<std::uint32_t>(isa))
+			.add(noise.seed).add(noise.octaves).add(noise.frequency).add(noise.amplitude).add(noise.lacunarity).add(noise.gain)
+			.add(spacing).add(baseHeight).add(quantizer.minimum).add(quantizer.extent)
+			.get();
+	}
+
+	// Generated chunks on disk, one file per chunk under <directory>/<generator hash>/.
+	// Changing any generator parameter changes the subdirectory, and every header
+	// repeats the hash and the chunk coordinates, so a stale or foreign file is never
+	// used. Files are written under a temporary name then renamed: a reader sees a
+	// complete tile or none.
+	class TileCache
+	{
+	public:
+		TileCache() = default;
+
+		TileCache(const std::string& directory, std::uint64_t generatorHash)
+			: m_generatorHash(generatorHash)
+		{
+			if (directory.empty())
+				return;
+
+			char name[17];
+			std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(generatorHash));
+			m_directory = std::filesystem::path(directory) / name;
+
+			std::error_code error;
+			std::filesystem::create_directories(m_directory, error);
+			m_enabled = !error;
+		}
+
+		bool isEnabled() const { return m_enabled; }
+
+		// Maps the tile of chunk (level, x, z) into file; false when absent or invalid
+		bool load(int level, int x, int z, utils::MappedFile& file, Aabb& bounds) const
+		{
+			if (!m_enabled || !file.open(getPath(level, x, z).string()))
+				return false;
+
+			if (file.size() != sizeof(TileHeader) + ChunkVertexCount * sizeof(TerrainVertex)) {
+				file.close();
+				return false;
+			}
+
+			TileHeader header;
+			std::memcpy(&header, file.data(), sizeof(header));
+			const bool valid = header.magic == TileMagic && header.version == TileVersion
+				&& header.generatorHash == m_generatorHash
+				&& header.level == level && header.x == x && header.z == z
+				&& header.vertexCount == ChunkVertexCount;
+
+			if (!valid) {
+				file.close();
+				return false;
+			}
+
+			bounds = { header.bounds[0], header.bounds[1], header.bounds[2], header.bounds[3], header.bounds[4], header.bounds[5] };
+			return true;
+		}
+
+		static const TerrainVertex* getVertices(const utils::MappedFile& file)
+		{
+			return reinterpret_cast<const TerrainVertex*>(file.data() + sizeof(TileHeader));
+		}
+
+		// Best effort: a failed write only costs a regeneration next time
+		void store(int level, int x, int z, const Aabb& bounds, const TerrainVertex* vertices) const
+		{
+			if (!m_enabled)
+				return;
+
+			TileHeader header;
+			header.generatorHash = m_generatorHash;
+			header.level = level;
+			header.x = x;
+			header.z = z;
+			const float values[6] = { bounds.minX, bounds.minY, bounds.minZ, bounds.maxX, bounds.maxY, bounds.maxZ };
+			std::memcpy(header.bounds, values, sizeof(values));
+
+			const std::filesystem::path path = getPath(level, x, z);
+			std::filesystem::path temporary = path;
+			temporary += ".tmp";
+
+			{
+				std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+				out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				out.write(reinterpret_cast<const char*>(vertices), ChunkVertexCount * sizeof(TerrainVertex));
+				if (!out)
+					return;
+			}
+
+			std::error_code error;
+			std::filesystem::rename(temporary, path, error);
+			if (error)
+				std::filesystem::remove(temporary, error);
+		}
+
+	private:
+		std::filesystem::path getPath(int level, int x, int z) const
+		{
+			return m_directory / ("L" + std::to_string(level) + "_" + std::to_string(x) + "_" + std::to_string(z) + ".tile");
+		}
+
+		std::filesystem::path m_directory;
+		std::uint64_t m_generatorHash = 0;
+		bool m_enabled = false;
+	};
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+#include "utils/threading/ThreadPool.h"
+
+namespace terrain {
+
+	constexpr int DefaultTileSize = 64;
+
+	// Samples [columnBegin, columnEnd) x [rowBegin, rowEnd) of a grid
+	struct TileRect
+	{
+		int columnBegin = 0;
+		int columnEnd = 0;
+		int rowBegin = 0;
+		int rowEnd = 0;
+
+		bool isEmpty() const { return columnBegin >= columnEnd || rowBegin >= rowEnd; }
+
+		bool overlaps(const TileRect& other) const
+		{
+			return columnBegin < other.columnEnd && other.columnBegin < columnEnd && rowBegin < other.rowEnd && other.rowBegin < rowEnd;
+		}
+
+		// Grown by margin samples on every side, then clipped to a width x height grid
+		TileRect expanded(int margin, int width, int height) const
+		{
+			return { std::max(columnBegin - margin, 0), std::min(columnEnd + margin, width), std::max(rowBegin - margin, 0), std::min(rowEnd + margin, height) };
+		}
+	};
+
+	// Runs fn(columnBegin, columnEnd, rowBegin, rowEnd) over the tiles of a width x height
+	// grid, spread over the thread pool. Tiles never overlap and their layout only depends
+	// on tileSize, so the output is the same whatever the number of threads.
+	template<typename Function>
+	void forEachTile(int width, int height, Function&& fn, int tileSize = DefaultTileSize)
+	{
+		if (width <= 0 || height <= 0)
+			return;
+
+		const size_t tilesX = (width + tileSize - 1) / tileSize;
+		const size_t tilesZ = (height + tileSize - 1) / tileSize;
+
+		utils::ThreadPoolInstance::GetInstance()->parallelFor(0, tilesX * tilesZ, 1, [&](size_t first, size_t last) {
+			for (size_t tile = first; tile < last; ++tile) {
+				const int columnBegin = static_cast<int>(tile % tilesX) * tileSize;
+				const int rowBegin = static_cast<int>(tile / tilesX) * tileSize;
+				fn(columnBegin, std::min(columnBegin + tileSize, width), rowBegin, std::min(rowBegin + tileSize, height));
+			}
+		});
+	}
+
+}
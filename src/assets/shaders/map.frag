@@ -2,42 +2,42 @@
 
 out vec4 fragColor;
 
-in vec4 iColor;
 in vec3 iWorldNormal;
 in vec3 iWorldPosition;
 
-struct Camera
+// Camera and light of the frame, shared by every program (FrameUniforms)
+layout (std140, binding = 0) uniform Frame
 {
-	vec3 worldPosition;
-};
+	mat4 viewMatrix;
+	mat4 projectionMatrix;
+	vec4 cameraPosition;
+	vec4 lightDirection;
+	vec4 lightColor;
+} frame;
 
 struct Material
 {
+	vec3 color;
 	float ambient;
 	float diffuse;
 	float specular;
 	float specularSmoothness;
 };
 
-struct DirectionalLight
-{
-	vec3 direction;
-	vec3 color;
-};
-
 uniform Material material;
-uniform DirectionalLight light;
-uniform Camera camera;
 
 void main()
 {
-	vec3 ambient = material.ambient * iColor.rgb;
-	vec3 diffuse = max(0, -dot(iWorldNormal, light.direction)) * light.color * iColor.rgb;
+	vec3 lightDirection = frame.lightDirection.xyz;
+	vec3 lightColor = frame.lightColor.rgb;
+
+	vec3 ambient = material.ambient * material.color;
+	vec3 diffuse = max(0, -dot(iWorldNormal, lightDirection)) * lightColor * material.color;
 	
-	vec3 worldEye = normalize(iWorldPosition - camera.worldPosition);
-	vec3 h = dot(iWorldNormal, light.direction) * iWorldNormal;
-	vec3 pprime = 2 * h - light.direction;
-	vec3 specular = light.color * pow(max(0, dot(worldEye, pprime)), material.specularSmoothness) * material.specular;
+	vec3 worldEye = normalize(iWorldPosition - frame.cameraPosition.xyz);
+	vec3 h = dot(iWorldNormal, lightDirection) * iWorldNormal;
+	vec3 pprime = 2 * h - lightDirection;
+	vec3 specular = lightColor * pow(max(0, dot(worldEye, pprime)), material.specularSmoothness) * material.specular;
 
 	fragColor = vec4(ambient + diffuse + specular, 1.f);
 }
\ No newline at end of file
@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include <memory>
 
 #include <engine/game/Game.h>
@@ -13,6 +14,11 @@ int main()
     engine::Game* game = engine::GameInstance::GetInstance();
     game->addScenes(new MainScene());
     game->setCurrentScene(0);
+
+    // TERRAIN_TICK_RATE=120 simulates the scene on its own thread, 120 ticks per second
+    if (const char* tickRate = std::getenv("TERRAIN_TICK_RATE"))
+        game->setSimulationRate(static_cast<float>(std::atof(tickRate)));
+
     game->run(sf::VideoMode(1280, 720), "ProceduralGeneration", sf::Style::Default, ScenesEnum::MAIN_SCENE);
     return 0;
 }
\ No newline at end of file
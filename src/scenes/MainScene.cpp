@@ -2,6 +2,10 @@
 #include "GL/glew.h"
 #include "SFML/OpenGL.hpp"
 
+#include "engine/game/Game.h"
+#include "engine/graphics/shaders/FrameUniforms.h"
+#include "engine/profiling/Profiler.h"
+
 #include "MainScene.h"
 
 using Mapf = Map<float>;
@@ -18,7 +22,8 @@ void MainScene::onBeginPlay()
 {
 	sf::Mouse::setPosition(sf::Vector2i(400, 300), m_window);
 
-	_map = std::make_unique<Mapf>();
+	_streamedMap = std::make_unique<StreamedMapf>();
+	_simulatedCameraPos = _mainCamera._cameraPos;
 }
 
 void MainScene::processInput(sf::Event& inputEvent)
@@ -28,10 +33,42 @@ void MainScene::processInput(sf::Event& inputEvent)
     if (inputEvent.key.code == sf::Keyboard::Escape) {
         m_window.close();
     }
+    else if (inputEvent.type == sf::Event::KeyPressed && inputEvent.key.code == sf::Keyboard::M) {
+        std::lock_guard<std::mutex> lock(_mapMutex);
+        _useFixedMap = !_useFixedMap;
+        if (_useFixedMap && !_map)
+            _map = std::make_unique<Mapf>();
+    }
+    else if (inputEvent.type == sf::Event::KeyPressed && inputEvent.key.code == sf::Keyboard::H && _useFixedMap) {
+        // H switches the fixed map between its vertex buffer chunks and the heightmap texture
+        std::lock_guard<std::mutex> lock(_mapMutex);
+        const bool heightmap = _map->getRenderPath() == Mapf::RenderPath::Heightmap;
+        _map->setRenderPath(heightmap ? Mapf::RenderPath::Chunks : Mapf::RenderPath::Heightmap);
+    }
+    else if (inputEvent.type == sf::Event::KeyPressed && inputEvent.key.code >= sf::Keyboard::Num1 && inputEvent.key.code <= sf::Keyboard::Num4) {
+        // 1 raise, 2 lower, 3 smooth, 4 flatten
+        std::lock_guard<std::mutex> lock(_inputMutex);
+        _brush.mode = static_cast<terrain::BrushMode>(inputEvent.key.code - sf::Keyboard::Num1);
+    }
+    else if (inputEvent.type == sf::Event::MouseWheelScrolled) {
+        std::lock_guard<std::mutex> lock(_inputMutex);
+        _brush.radius = std::clamp(_brush.radius * (inputEvent.mouseWheelScroll.delta > 0 ? 1.25f : 0.8f), 0.05f, 5.f);
+    }
+    else if (inputEvent.type == sf::Event::MouseButtonPressed && inputEvent.mouseButton.button == sf::Mouse::Left && _useFixedMap) {
+        // the stroke starts where the camera looks at the next step
+        std::lock_guard<std::mutex> lock(_inputMutex);
+        _sculpting = true;
+        _strokeStarting = true;
+    }
+    else if (inputEvent.type == sf::Event::MouseButtonReleased && inputEvent.mouseButton.button == sf::Mouse::Left) {
+        std::lock_guard<std::mutex> lock(_inputMutex);
+        _sculpting = false;
+    }
     else if (inputEvent.type == sf::Event::MouseMoved) {
         float dx = 400.f - float(inputEvent.mouseMove.x);
         float dy = 300.f - float(inputEvent.mouseMove.y);
         sf::Mouse::setPosition(sf::Vector2i(400, 300), m_window);
+        std::lock_guard<std::mutex> lock(_inputMutex);
         _mainCamera._cameraYaw += 0.001f * dx;
         _mainCamera._cameraPitch -= 0.001f * dy;
     }
@@ -41,14 +78,161 @@ void MainScene::processInput(sf::Event& inputEvent)
 
 void MainScene::update(const float& deltaTime)
 {
-    _mainCamera.ViewMatrix = Mat4f::rotationX(-_mainCamera._cameraPitch) * Mat4f::rotationY(-_mainCamera._cameraYaw) * Mat4f::translation(-_mainCamera._cameraPos.x, -_mainCamera._cameraPos.y, -_mainCamera._cameraPos.z);
+    PROFILE_SCOPE("scene update");
+
+    // the erosion spreads over the thread pool while the main thread moves the camera;
+    // the brush then picks the eroded heights, and the main thread uploads what both changed
+    using engine::TaskGraph;
+    TaskGraph& tasks = engine::GameInstance::GetInstance()->getFrameTasks();
+    const bool eroding = sf::Keyboard::isKeyPressed(sf::Keyboard::T);
+
+    const TaskGraph::TaskId cameraTask = tasks.add("camera", [this, deltaTime] {
+        moveCamera(_mainCamera._cameraPos, deltaTime);
+        _mainCamera.ViewMatrix = getViewMatrix();
+    }, {}, TaskGraph::Affinity::Main);
+    const TaskGraph::TaskId erosionTask = tasks.add("thermal erosion", [this, eroding] {
+        if (eroding)
+            erode();
+    });
+    const TaskGraph::TaskId sculptTask = tasks.add("brush", [this, deltaTime] {
+        sculpt(_mainCamera._cameraPos, deltaTime);
+    }, { cameraTask, erosionTask });
+    tasks.add("map update", [this] {
+        if (_map)
+            _map->update();
+    }, { sculptTask }, TaskGraph::Affinity::Main);
+}
+
+void MainScene::simulate(const float& deltaTime, double time)
+{
+    PROFILE_SCOPE("scene simulate");
+
+    step(_simulatedCameraPos, deltaTime);
+    _snapshots.publish({ _simulatedCameraPos }, time);
+}
+
+void MainScene::prepareRender(double time)
+{
+    SimulationState previous;
+    SimulationState next;
+    float alpha;
+    if (_snapshots.sample(time, previous, next, alpha))
+        _mainCamera._cameraPos = previous.cameraPosition + (next.cameraPosition - previous.cameraPosition) * alpha;
+
+    // the mouse turns the camera at the frame rate, only its position is simulated
+    _mainCamera.ViewMatrix = getViewMatrix();
+
+    // a step holding the map is still editing it: what it changed shows next frame
+    std::unique_lock<std::mutex> lock(_mapMutex, std::try_to_lock);
+    if (lock.owns_lock() && _map)
+        _map->update();
+}
+
+void MainScene::step(Point3f& position, float deltaTime)
+{
+    moveCamera(position, deltaTime);
+    sculpt(position, deltaTime);
+
+    // T erodes the fixed map while held
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::T))
+        erode();
+}
+
+void MainScene::moveCamera(Point3f& position, float deltaTime)
+{
+    float yaw;
+    {
+        std::lock_guard<std::mutex> lock(_inputMutex);
+        yaw = _mainCamera._cameraYaw;
+    }
+
+    // WASD moves along the view direction projected on the ground, space / shift up and down
+    float forward = 0.f;
+    float right = 0.f;
+    float up = 0.f;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::W)) forward += 1.f;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::S)) forward -= 1.f;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::D)) right += 1.f;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::A)) right -= 1.f;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Space)) up += 1.f;
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::LShift)) up -= 1.f;
+
+    const float distance = _mainCamera._cameraSpeed * deltaTime;
+    const float sinYaw = std::sin(yaw);
+    const float cosYaw = std::cos(yaw);
+    position.x += (-sinYaw * forward + cosYaw * right) * distance;
+    position.z += (-cosYaw * forward - sinYaw * right) * distance;
+    position.y += up * distance;
+}
+
+void MainScene::sculpt(const Point3f& position, float deltaTime)
+{
+    std::lock_guard<std::mutex> mapLock(_mapMutex);
+    if (!_useFixedMap)
+        return;
+
+    terrain::Brush brush;
+    bool sculpting;
+    bool strokeStarting;
+    float yaw;
+    float pitch;
+    {
+        std::lock_guard<std::mutex> lock(_inputMutex);
+        yaw = _mainCamera._cameraYaw;
+        pitch = _mainCamera._cameraPitch;
+        brush = _brush;
+        sculpting = _sculpting;
+        strokeStarting = _strokeStarting;
+    }
+
+    if (sculpting) {
+        PROFILE_SCOPE("sculpt");
 
-    _map->update();
+        // the cursor stays at the center of the window: the brush goes where the camera looks
+        Point3f hit;
+        const bool hits = _map->pick(position, getViewDirection(yaw, pitch), hit);
+        if (strokeStarting) {
+            // Flatten levels the stroke at the height it started from; a stroke starting off the terrain does nothing
+            std::lock_guard<std::mutex> lock(_inputMutex);
+            _strokeStarting = false;
+            _sculpting = hits;
+            _brush.targetHeight = brush.targetHeight = hit.y;
+        }
+        if (hits)
+            _map->sculpt(brush, hit, deltaTime);
+    }
+}
+
+void MainScene::erode()
+{
+    std::lock_guard<std::mutex> lock(_mapMutex);
+    if (_useFixedMap)
+        _map->erodeThermal(ThermalStepsPerFrame);
+}
+
+Point3f MainScene::getViewDirection(float yaw, float pitch)
+{
+    // the camera looks down -z of the view space
+    const Mat4f view = Mat4f::rotationX(-pitch) * Mat4f::rotationY(-yaw);
+    return Point3f(-view(2, 0), -view(2, 1), -view(2, 2));
+}
+
+Mat4f MainScene::getViewMatrix() const
+{
+    return Mat4f::rotationX(-_mainCamera._cameraPitch) * Mat4f::rotationY(-_mainCamera._cameraYaw) * Mat4f::translation(-_mainCamera._cameraPos.x, -_mainCamera._cameraPos.y, -_mainCamera._cameraPos.z);
 }
 
 void MainScene::render()
 {
-    _map->render(_mainCamera.ViewMatrix, _mainCamera.ProjectionMatrix);
+    PROFILE_GPU_SCOPE("terrain");
+
+    // one upload of the camera and the sun for every program of the frame
+    FrameUniformsInstance::GetInstance()->update(_mainCamera.ViewMatrix, _mainCamera.ProjectionMatrix, _mainCamera._cameraPos, Point3f(0.f, -1.f, 0.f), Point3f(1.f, 1.f, 1.f));
+
+    if (_useFixedMap)
+        _map->render(_mainCamera.ViewMatrix, _mainCamera.ProjectionMatrix, _mainCamera._cameraPos);
+    else
+        _streamedMap->render(_mainCamera.ViewMatrix, _mainCamera.ProjectionMatrix, _mainCamera._cameraPos);
     glFlush();
 }
 
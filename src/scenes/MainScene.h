@@ -1,10 +1,15 @@
 #pragma once
+#include <mutex>
+
 #include <engine/Scene/Scene.h>
+#include <engine/game/SnapshotBuffer.h>
 #include <engine/graphics/camera/Camera.h>
 
 #include <engine/graphics/shapes/Map.h>
+#include <engine/graphics/shapes/StreamedMap.h>
 
 using Mapf = Map<float>;
+using StreamedMapf = StreamedMap<float>;
 
 class MainScene : public engine::IScene
 {
@@ -20,7 +25,50 @@ public:
     void update(const float& deltaTime) override;
     void render() override;
 
+    void simulate(const float& step, double time) override;
+    void prepareRender(double time) override;
+
     Camera _mainCamera;
+
+    // the streamed world is drawn unless the fixed map is toggled on (M)
+    std::unique_ptr<StreamedMapf> _streamedMap;
     std::unique_ptr<Mapf> _map;
+    bool _useFixedMap = false;
+
+    // left button sculpts the fixed map, 1-4 pick the mode, the wheel the radius
+    terrain::Brush _brush;
+    bool _sculpting = false;
+    bool _strokeStarting = false;
 private:
+    static constexpr int ThermalStepsPerFrame = 8;
+
+    // What the simulation thread publishes for the render thread to interpolate
+    struct SimulationState
+    {
+        Point3f cameraPosition;
+    };
+
+    // Moves the camera from position and edits the fixed map for deltaTime seconds:
+    // moveCamera, sculpt, then erode while T is held
+    void step(Point3f& position, float deltaTime);
+
+    // Moves position with WASD, space and shift for deltaTime seconds
+    void moveCamera(Point3f& position, float deltaTime);
+
+    // Applies the brush where the camera at position looks, while the left button is held
+    void sculpt(const Point3f& position, float deltaTime);
+
+    // A few steps of thermal erosion of the fixed map
+    void erode();
+
+    static Point3f getViewDirection(float yaw, float pitch);
+    Mat4f getViewMatrix() const;
+
+    // With a simulation thread: the camera angles and the brush are set by the input of
+    // the main thread and read by the simulation (_inputMutex); the fixed map is edited
+    // by the simulation and refreshed and drawn by the main thread (_mapMutex)
+    std::mutex _inputMutex;
+    std::mutex _mapMutex;
+    Point3f _simulatedCameraPos;
+    engine::SnapshotBuffer<SimulationState> _snapshots;
 };
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace utils {
+
+    // Read-only memory mapping of a whole file. The pages are loaded on first access
+    // by the OS, so data() can be handed straight to consumers without reading or
+    // copying the file.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+
+        ~MappedFile()
+        {
+            close();
+        }
+
+        MappedFile(MappedFile&& other) noexcept
+        {
+            swap(other);
+        }
+
+        MappedFile& operator=(MappedFile&& other) noexcept
+        {
+            if (this != &other)
+            {
+                close();
+                swap(other);
+            }
+            return *this;
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // Returns false when the file is missing, empty or cannot be mapped
+        bool open(const std::string& path)
+        {
+            close();
+
+#if defined(_WIN32)
+            m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (m_file == INVALID_HANDLE_VALUE)
+                return false;
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+            {
+                close();
+                return false;
+            }
+
+            m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_mapping == nullptr)
+            {
+                close();
+                return false;
+            }
+
+            m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+            m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+            const int file = ::open(path.c_str(), O_RDONLY);
+            if (file < 0)
+                return false;
+
+            struct stat status;
+            if (fstat(file, &status) != 0 || status.st_size == 0)
+            {
+                ::close(file);
+                return false;
+            }
+
+            void* data = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            ::close(file);
+            if (data == MAP_FAILED)
+                return false;
+
+            m_data = data;
+            m_size = static_cast<std::size_t>(status.st_size);
+#endif
+            if (m_data == nullptr)
+            {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        void close()
+        {
+#if defined(_WIN32)
+            if (m_data != nullptr)
+                UnmapViewOfFile(m_data);
+            if (m_mapping != nullptr)
+                CloseHandle(m_mapping);
+            if (m_file != INVALID_HANDLE_VALUE)
+                CloseHandle(m_file);
+            m_mapping = nullptr;
+            m_file = INVALID_HANDLE_VALUE;
+#else
+            if (m_data != nullptr)
+                munmap(m_data, m_size);
+#endif
+            m_data = nullptr;
+            m_size = 0;
+        }
+
+        bool isOpen() const { return m_data != nullptr; }
+        const std::byte* data() const { return static_cast<const std::byte*>(m_data); }
+        std::size_t size() const { return m_size; }
+
+    private:
+        void swap(MappedFile& other) noexcept
+        {
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+#if defined(_WIN32)
+            std::swap(m_file, other.m_file);
+            std::swap(m_mapping, other.m_mapping);
+#endif
+        }
+
+        void* m_data = nullptr;
+        std::size_t m_size = 0;
+#if defined(_WIN32)
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+#endif
+    };
+
+}
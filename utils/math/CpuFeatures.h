@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define TERRAIN_CPU_X86 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define TERRAIN_CPU_X86 1
+#endif
+
+// Instruction sets the hot kernels are built for, from the narrowest, and what the
+// running CPU and OS support of them.
+namespace simd {
+
+    enum class Isa
+    {
+        Scalar,
+        Sse2,
+        Avx2,
+        Avx512
+    };
+
+    inline const char* getIsaName(Isa isa)
+    {
+        switch (isa)
+        {
+        case Isa::Sse2: return "sse2";
+        case Isa::Avx2: return "avx2";
+        case Isa::Avx512: return "avx512";
+        default: return "scalar";
+        }
+    }
+
+    // False when name is none of the getIsaName names
+    inline bool parseIsa(const char* name, Isa& isa)
+    {
+        for (Isa candidate : { Isa::Scalar, Isa::Sse2, Isa::Avx2, Isa::Avx512 })
+        {
+            if (std::strcmp(name, getIsaName(candidate)) == 0)
+            {
+                isa = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+#if defined(TERRAIN_CPU_X86)
+    namespace cpu {
+
+        struct Registers
+        {
+            std::uint32_t eax = 0;
+            std::uint32_t ebx = 0;
+            std::uint32_t ecx = 0;
+            std::uint32_t edx = 0;
+        };
+
+        inline Registers cpuid(std::uint32_t leaf, std::uint32_t subleaf = 0)
+        {
+            Registers r;
+#if defined(_MSC_VER)
+            int values[4];
+            __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+            r.eax = static_cast<std::uint32_t>(values[0]);
+            r.ebx = static_cast<std::uint32_t>(values[1]);
+            r.ecx = static_cast<std::uint32_t>(values[2]);
+            r.edx = static_cast<std::uint32_t>(values[3]);
+#else
+            __cpuid_count(leaf, subleaf, r.eax, r.ebx, r.ecx, r.edx);
+#endif
+            return r;
+        }
+
+        // Register state the OS saves on context switches (XCR0)
+        inline std::uint64_t getEnabledState()
+        {
+#if defined(_MSC_VER)
+            return _xgetbv(0);
+#else
+            std::uint32_t eax;
+            std::uint32_t edx;
+            __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return (static_cast<std::uint64_t>(edx) << 32) | eax;
+#endif
+        }
+
+    }
+#endif
+
+    // Widest instruction set of the list both the CPU and the OS support: AVX needs the
+    // OS to save the ymm registers, AVX-512 the zmm and mask registers as well
+    inline Isa detectIsa()
+    {
+#if defined(TERRAIN_CPU_X86)
+        const std::uint32_t maxLeaf = cpu::cpuid(0).eax;
+        const cpu::Registers leaf1 = cpu::cpuid(1);
+        if ((leaf1.edx & (1u << 26)) == 0)
+            return Isa::Scalar;
+
+        const bool hasXsave = (leaf1.ecx & (1u << 27)) != 0;     // OSXSAVE
+        const bool hasAvx = (leaf1.ecx & (1u << 28)) != 0;
+        if (!hasXsave || !hasAvx || maxLeaf < 7)
+            return Isa::Sse2;
+
+        const std::uint64_t state = cpu::getEnabledState();
+        const cpu::Registers leaf7 = cpu::cpuid(7, 0);
+        const bool saveYmm = (state & 0x6) == 0x6;
+        const bool saveZmm = (state & 0xe6) == 0xe6;
+
+        if (saveZmm && (leaf7.ebx & (1u << 16)) != 0)       // AVX512F
+            return Isa::Avx512;
+        if (saveYmm && (leaf7.ebx & (1u << 5)) != 0)        // AVX2
+            return Isa::Avx2;
+        return Isa::Sse2;
+#else
+        return Isa::Scalar;
+#endif
+    }
+
+    inline bool isSupported(Isa isa)
+    {
+        return static_cast<int>(isa) <= static_cast<int>(detectIsa());
+    }
+
+}
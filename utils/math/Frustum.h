@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "utils/math/Math.h"
+#include "utils/math/Simd.h"
+#include "utils/memory/AlignedAllocator.h"
+
+// Axis-aligned boxes stored as centers and half extents, one array per coordinate,
+// so a whole batch is tested against a plane B::width boxes at a time
+struct AabbBatch
+{
+    using Array = std::vector<float, utils::AlignedAllocator<float>>;
+
+    size_t size() const { return centerX.size(); }
+
+    void resize(size_t count)
+    {
+        for (Array* array : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ })
+            array->resize(count);
+    }
+
+    void set(size_t i, float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+    {
+        centerX[i] = 0.5f * (minX + maxX);
+        centerY[i] = 0.5f * (minY + maxY);
+        centerZ[i] = 0.5f * (minZ + maxZ);
+        extentX[i] = 0.5f * (maxX - minX);
+        extentY[i] = 0.5f * (maxY - minY);
+        extentZ[i] = 0.5f * (maxZ - minZ);
+    }
+
+    Array centerX;
+    Array centerY;
+    Array centerZ;
+    Array extentX;
+    Array extentY;
+    Array extentZ;
+};
+
+// The six planes of a clip volume, normals pointing inwards. Planes are not
+// normalized: only the sign of the distances matters for culling.
+class Frustum
+{
+public:
+    struct Plane
+    {
+        float a = 0.f;
+        float b = 0.f;
+        float c = 0.f;
+        float d = 0.f;
+    };
+
+    // Planes bounding -w <= x, y, z <= w for clip = matrix * p (Gribb & Hartmann).
+    // With matrix = Projection * View * Model the planes live in model space.
+    static Frustum fromMatrix(const Mat4<float>& matrix)
+    {
+        auto row = [&](int line) {
+            return Plane{ matrix(line, 0), matrix(line, 1), matrix(line, 2), matrix(line, 3) };
+        };
+        auto combine = [](const Plane& p, const Plane& q, float sign) {
+            return Plane{ p.a + sign * q.a, p.b + sign * q.b, p.c + sign * q.c, p.d + sign * q.d };
+        };
+
+        const Plane w = row(3);
+        Frustum frustum;
+        for (int axis = 0; axis < 3; ++axis) {
+            frustum.m_planes[axis * 2] = combine(w, row(axis), 1.f);
+            frustum.m_planes[axis * 2 + 1] = combine(w, row(axis), -1.f);
+        }
+        return frustum;
+    }
+
+    const std::array<Plane, 6>& getPlanes() const { return m_planes; }
+
+    // For count boxes from first, writes the smallest signed distance between the
+    // planes and the box corner furthest along each plane normal: negative when the
+    // box is fully outside one of the planes. Returns how many boxes were done.
+    template<typename B>
+    size_t marginSpan(const AabbBatch& boxes, size_t first, size_t count, float* out) const
+    {
+        using Float = typename B::Float;
+
+        // plane coefficients broadcast once for the whole span
+        Float a[6], b[6], c[6], d[6], absA[6], absB[6], absC[6];
+        for (int p = 0; p < 6; ++p) {
+            a[p] = B::broadcast(m_planes[p].a);
+            b[p] = B::broadcast(m_planes[p].b);
+            c[p] = B::broadcast(m_planes[p].c);
+            d[p] = B::broadcast(m_planes[p].d);
+            absA[p] = B::broadcast(std::abs(m_planes[p].a));
+            absB[p] = B::broadcast(std::abs(m_planes[p].b));
+            absC[p] = B::broadcast(std::abs(m_planes[p].c));
+        }
+
+        size_t k = 0;
+        for (; k + B::width <= count; k += B::width) {
+            const size_t i = first + k;
+            const Float cx = B::load(boxes.centerX.data() + i);
+            const Float cy = B::load(boxes.centerY.data() + i);
+            const Float cz = B::load(boxes.centerZ.data() + i);
+            const Float ex = B::load(boxes.extentX.data() + i);
+            const Float ey = B::load(boxes.extentY.data() + i);
+            const Float ez = B::load(boxes.extentZ.data() + i);
+
+            Float margin = B::broadcast(std::numeric_limits<float>::max());
+            for (int p = 0; p < 6; ++p) {
+                // center distance plus the box projected on the plane normal
+                const Float center = B::add(B::add(B::mul(cx, a[p]), B::mul(cy, b[p])), B::add(B::mul(cz, c[p]), d[p]));
+                const Float radius = B::add(B::add(B::mul(ex, absA[p]), B::mul(ey, absB[p])), B::mul(ez, absC[p]));
+                margin = B::min(margin, B::add(center, radius));
+            }
+            B::store(out + k, margin);
+        }
+        return k;
+    }
+
+    // One box at a time, same test as marginSpan
+    bool intersects(float minX, float minY, float minZ, float maxX, float maxY, float maxZ) const
+    {
+        const float cx = 0.5f * (minX + maxX);
+        const float cy = 0.5f * (minY + maxY);
+        const float cz = 0.5f * (minZ + maxZ);
+        const float ex = 0.5f * (maxX - minX);
+        const float ey = 0.5f * (maxY - minY);
+        const float ez = 0.5f * (maxZ - minZ);
+
+        for (const Plane& plane : m_planes) {
+            const float center = plane.a * cx + plane.b * cy + plane.c * cz + plane.d;
+            const float radius = std::abs(plane.a) * ex + std::abs(plane.b) * ey + std::abs(plane.c) * ez;
+            if (center + radius < 0.f)
+                return false;
+        }
+        return true;
+    }
+
+    // Tests every box of the batch in one pass: visible[i] is 1 when box i is at
+    // least partly inside the frustum
+    void cull(const AabbBatch& boxes, std::vector<std::uint8_t>& visible) const
+    {
+        constexpr size_t BlockSize = 256;
+        alignas(64) float margins[BlockSize];
+
+        visible.resize(boxes.size());
+        for (size_t first = 0; first < boxes.size(); first += BlockSize) {
+            const size_t count = std::min(BlockSize, boxes.size() - first);
+            const size_t done = marginSpan<simd::Native>(boxes, first, count, margins);
+            marginSpan<simd::Scalar>(boxes, first + done, count - done, margins + done);
+
+            for (size_t k = 0; k < count; ++k)
+                visible[first + k] = margins[k] >= 0.f;
+        }
+    }
+
+private:
+    std::array<Plane, 6> m_planes;
+};
@@ -4,6 +4,8 @@
 #include <array>
 #include <cmath>
 
+#include "utils/math/Simd.h"
+
 template<typename T>
 struct Point2d
 {
@@ -98,6 +100,30 @@ struct Mat4
         return &m_data[0];
     }
 
+    Type* getData()
+    {
+        return &m_data[0];
+    }
+
+    // p as a point (w = 1) and as a direction (w = 0), without perspective division
+    Point3d<Type> transformPoint(const Point3d<Type>& p) const
+    {
+        const Mat4<Type>& m = *this;
+        return Point3d<Type>(
+            m(0, 0) * p.x + m(0, 1) * p.y + m(0, 2) * p.z + m(0, 3),
+            m(1, 0) * p.x + m(1, 1) * p.y + m(1, 2) * p.z + m(1, 3),
+            m(2, 0) * p.x + m(2, 1) * p.y + m(2, 2) * p.z + m(2, 3));
+    }
+
+    Point3d<Type> transformDirection(const Point3d<Type>& d) const
+    {
+        const Mat4<Type>& m = *this;
+        return Point3d<Type>(
+            m(0, 0) * d.x + m(0, 1) * d.y + m(0, 2) * d.z,
+            m(1, 0) * d.x + m(1, 1) * d.y + m(1, 2) * d.z,
+            m(2, 0) * d.x + m(2, 1) * d.y + m(2, 2) * d.z);
+    }
+
     static Mat4<Type> identity()
     {
         Mat4<Type> result;
@@ -157,7 +183,8 @@ private:
         return result;
     };
 
-    std::array<Type, 16> m_data;
+    // column-major, columns 16-byte aligned for the vector product
+    alignas(16) std::array<Type, 16> m_data;
 };
 
 template<typename Type>
@@ -175,6 +202,34 @@ Mat4<Type> operator*(const Mat4<Type>& op1, const Mat4<Type>& op2)
     return result;
 }
 
+#if defined(TERRAIN_SIMD_SSE2)
+// Column j of the product is the columns of op1 weighted by the entries of column j of
+// op2: four broadcasts and multiply-adds per column instead of 64 scalar products
+template<>
+inline Mat4<float> operator*(const Mat4<float>& op1, const Mat4<float>& op2)
+{
+    const float* a = op1.getData();
+    const float* b = op2.getData();
+    const __m128 c0 = _mm_load_ps(a);
+    const __m128 c1 = _mm_load_ps(a + 4);
+    const __m128 c2 = _mm_load_ps(a + 8);
+    const __m128 c3 = _mm_load_ps(a + 12);
+
+    Mat4<float> result;
+    float* out = result.getData();
+    for (int j = 0; j < 4; ++j)
+    {
+        const float* column = b + 4 * j;
+        __m128 sum = _mm_mul_ps(c0, _mm_set1_ps(column[0]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(c1, _mm_set1_ps(column[1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(c2, _mm_set1_ps(column[2])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(c3, _mm_set1_ps(column[3])));
+        _mm_store_ps(out + 4 * j, sum);
+    }
+    return result;
+}
+#endif
+
 template<typename Type>
 struct Color
 {
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "utils/math/Simd.h"
+
+struct NoiseSettings
+{
+    std::uint32_t seed = 1337;
+    int octaves = 6;
+    float frequency = 0.25f;
+    float amplitude = 0.5f;
+    float lacunarity = 2.f;
+    float gain = 0.5f;
+};
+
+namespace noise {
+
+    constexpr std::uint32_t PrimeX = 0x8da6b343u;
+    constexpr std::uint32_t PrimeZ = 0xd8163841u;
+    constexpr std::uint32_t HashMultiplier = 0x27d4eb2du;
+    constexpr std::uint32_t OctaveSeedStep = 0x9e3779b9u;
+
+    // Gradient for the lattice corner hashed to h, dotted with the offset (dx, dz).
+    // The two top bits of the hash pick one of the four diagonal gradients.
+    template<typename B>
+    inline typename B::Float gradient(typename B::Int h, typename B::Float dx, typename B::Float dz)
+    {
+        const typename B::Int signBit = B::broadcastInt(0x80000000u);
+        const typename B::Float gx = B::flipSign(dx, B::bitAnd(h, signBit));
+        const typename B::Float gz = B::flipSign(dz, B::bitAnd(B::template shiftLeft<1>(h), signBit));
+        return B::add(gx, gz);
+    }
+
+    template<typename B>
+    inline typename B::Int hash(typename B::Int seed, typename B::Int xPrimed, typename B::Int zPrimed)
+    {
+        return B::mul(B::bitXor(B::bitXor(seed, xPrimed), zPrimed), B::broadcastInt(HashMultiplier));
+    }
+
+    // 6t^5 - 15t^4 + 10t^3
+    template<typename B>
+    inline typename B::Float fade(typename B::Float t)
+    {
+        const typename B::Float inner = B::add(B::mul(t, B::sub(B::mul(t, B::broadcast(6.f)), B::broadcast(15.f))), B::broadcast(10.f));
+        return B::mul(B::mul(B::mul(t, t), t), inner);
+    }
+
+    template<typename B>
+    inline typename B::Float lerp(typename B::Float a, typename B::Float b, typename B::Float t)
+    {
+        return B::add(a, B::mul(t, B::sub(b, a)));
+    }
+
+    // 2D Perlin gradient noise, roughly in [-1, 1]. Lattice corners are hashed
+    // arithmetically instead of through a permutation table so every lane runs
+    // without gathers.
+    template<typename B>
+    inline typename B::Float perlin(typename B::Float x, typename B::Float z, typename B::Int seed)
+    {
+        using Float = typename B::Float;
+        using Int = typename B::Int;
+
+        const Float x0 = B::floor(x);
+        const Float z0 = B::floor(z);
+        const Float fx0 = B::sub(x, x0);
+        const Float fz0 = B::sub(z, z0);
+        const Float fx1 = B::sub(fx0, B::broadcast(1.f));
+        const Float fz1 = B::sub(fz0, B::broadcast(1.f));
+
+        // (i + 1) * prime == i * prime + prime in wrapping arithmetic
+        const Int ix0 = B::mul(B::toInt(x0), B::broadcastInt(PrimeX));
+        const Int iz0 = B::mul(B::toInt(z0), B::broadcastInt(PrimeZ));
+        const Int ix1 = B::add(ix0, B::broadcastInt(PrimeX));
+        const Int iz1 = B::add(iz0, B::broadcastInt(PrimeZ));
+
+        const Float g00 = gradient<B>(hash<B>(seed, ix0, iz0), fx0, fz0);
+        const Float g10 = gradient<B>(hash<B>(seed, ix1, iz0), fx1, fz0);
+        const Float g01 = gradient<B>(hash<B>(seed, ix0, iz1), fx0, fz1);
+        const Float g11 = gradient<B>(hash<B>(seed, ix1, iz1), fx1, fz1);
+
+        const Float u = fade<B>(fx0);
+        const Float v = fade<B>(fz0);
+        return lerp<B>(lerp<B>(g00, g10, u), lerp<B>(g01, g11, u), v);
+    }
+
+    // Fractal Brownian motion: settings.octaves layers of Perlin noise
+    template<typename B>
+    inline typename B::Float fbm(const NoiseSettings& settings, typename B::Float x, typename B::Float z)
+    {
+        using Float = typename B::Float;
+
+        Float sum = B::broadcast(0.f);
+        float frequency = settings.frequency;
+        float amplitude = settings.amplitude;
+        std::uint32_t seed = settings.seed;
+
+        for (int octave = 0; octave < settings.octaves; ++octave)
+        {
+            const Float f = B::broadcast(frequency);
+            const Float n = perlin<B>(B::mul(x, f), B::mul(z, f), B::broadcastInt(seed));
+            sum = B::add(sum, B::mul(n, B::broadcast(amplitude)));
+
+            frequency *= settings.lacunarity;
+            amplitude *= settings.gain;
+            seed += OctaveSeedStep;
+        }
+        return sum;
+    }
+
+    // Evaluates the points (x0 + k * dx, z0 + k * dz) for k in [first, first + count) into out,
+    // B::width points per step. The tail goes through the same vector kernel and coordinates
+    // only depend on k, so splitting a line in pieces never changes the result.
+    template<typename B>
+    inline void fbmLine(const NoiseSettings& settings, float x0, float z0, float dx, float dz, std::size_t first, std::size_t count, float* out)
+    {
+        using Float = typename B::Float;
+
+        const Float ramp = B::ramp();
+        const Float originX = B::broadcast(x0);
+        const Float originZ = B::broadcast(z0);
+        const Float stepX = B::broadcast(dx);
+        const Float stepZ = B::broadcast(dz);
+
+        auto evaluate = [&](std::size_t k)
+        {
+            const Float index = B::add(B::broadcast(static_cast<float>(first + k)), ramp);
+            return fbm<B>(settings, B::add(originX, B::mul(index, stepX)), B::add(originZ, B::mul(index, stepZ)));
+        };
+
+        const std::size_t full = count - count % B::width;
+        for (std::size_t k = 0; k < full; k += B::width)
+            B::store(out + k, evaluate(k));
+
+        if (full < count)
+        {
+            alignas(64) float tail[B::width];
+            B::store(tail, evaluate(full));
+            for (std::size_t k = full; k < count; ++k)
+                out[k] = tail[k - full];
+        }
+    }
+
+}
+
+class FractalNoise
+{
+public:
+    explicit FractalNoise(const NoiseSettings& settings = NoiseSettings())
+        : m_settings(settings)
+    {}
+
+    const NoiseSettings& getSettings() const { return m_settings; }
+
+    // Largest absolute value sample() can return: the octave amplitudes summed
+    float getAmplitudeBound() const
+    {
+        float bound = 0.f;
+        float amplitude = m_settings.amplitude;
+        for (int octave = 0; octave < m_settings.octaves; ++octave)
+        {
+            bound += amplitude;
+            amplitude *= m_settings.gain;
+        }
+        return bound;
+    }
+
+    float sample(float x, float z) const
+    {
+        float result;
+        noise::fbmLine<simd::Native>(m_settings, x, z, 0.f, 0.f, 0, 1, &result);
+        return result;
+    }
+
+    // Fills out[k - first] with the noise at (x0 + k * dx, z0 + k * dz) for k in [first, first + count)
+    void sampleLine(float x0, float z0, float dx, float dz, std::size_t first, std::size_t count, float* out) const
+    {
+        noise::fbmLine<simd::Native>(m_settings, x0, z0, dx, dz, first, count, out);
+    }
+
+private:
+    NoiseSettings m_settings;
+};
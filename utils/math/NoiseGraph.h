@@ -0,0 +1,327 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "utils/design_patterns/TypeList.h"
+#include "utils/math/Noise.h"
+#include "utils/math/Simd.h"
+
+// Noise pipelines composed at compile time. Every module is a plain struct holding its
+// parameters and its inputs by value, and evaluates B::width points at once:
+//
+//     template<typename B> typename B::Float evaluate(typename B::Float x, typename B::Float z, std::uint32_t seed) const;
+//
+// A whole graph is then one concrete type: evaluateLine instantiates it for a backend
+// and the compiler inlines the modules into a single loop, without virtual calls or
+// buffers between them. Meant for fixed presets, where nothing changes at runtime.
+//
+//     using Hills = noise::Chain<typelist<noise::Fbm<noise::Perlin, 6>, noise::ScaleBias>>;
+
+namespace noise {
+
+    constexpr std::uint32_t WarpSeedX = 0x68e31da4u;
+    constexpr std::uint32_t WarpSeedZ = 0xb5297a4du;
+
+    template<typename B>
+    inline typename B::Float abs(typename B::Float value)
+    {
+        return B::max(value, B::sub(B::broadcast(0.f), value));
+    }
+
+    template<typename B>
+    inline typename B::Float clamp(typename B::Float value, float low, float high)
+    {
+        return B::min(B::max(value, B::broadcast(low)), B::broadcast(high));
+    }
+
+    // Gradient noise, roughly in [-1, 1]
+    struct Perlin
+    {
+        template<typename B>
+        typename B::Float evaluate(typename B::Float x, typename B::Float z, std::uint32_t seed) const
+        {
+            return perlin<B>(x, z, B::broadcastInt(seed));
+        }
+    };
+
+    // Octaves layers of source, each at lacunarity times the frequency and gain times
+    // the amplitude of the previous one, with its own seed. Fbm<Perlin, n> matches the
+    // fbm of FractalNoise with n octaves.
+    template<typename Source, int Octaves>
+    struct Fbm
+    {
+        Source source;
+        float frequency = 0.25f;
+        float amplitude = 0.5f;
+        float lacunarity = 2.f;
+        float gain = 0.5f;
+
+        template<typename B>
+        typename B::Float evaluate(typename B::Float x, typename B::Float z, std::uint32_t seed) const
+        {
+            typename B::Float sum = B::broadcast(0.f);
+            float octaveFrequency = frequency;
+            float octaveAmplitude = amplitude;
+
+            for (int octave = 0; octave < Octaves; ++octave)
+            {
+                const typename B::Float f = B::broadcast(octaveFrequency);
+                const typename B::Float n = source.template evaluate<B>(B::mul(x, f), B::mul(z, f), seed);
+                sum = B::add(sum, B::mul(n, B::broadcast(octaveAmplitude)));
+
+                octaveFrequency *= lacunarity;
+                octaveAmplitude *= gain;
+                seed += OctaveSeedStep;
+            }
+            return sum;
+        }
+    };
+
+    // Musgrave's ridged multifractal: sharp crests where the source crosses zero, and
+    // octaves weighted by the previous ones so that valleys stay smooth. Mostly in [0, 2].
+    template<typename Source, int Octaves>
+    struct RidgedMulti
+    {
+        Source source;
+        float frequency = 0.25f;
+        float amplitude = 0.5f;
+        float lacunarity = 2.f;
+        float gain = 0.5f;
+        float offset = 1.f;
+        float sharpness = 2.f;      // how much a crest lets the next octave through
+
+        template<typename B>
+        typename B::Float evaluate(typename B::Float x, typename B::Float z, std::uint32_t seed) const
+        {
+            using Float = typename B::Float;
+
+            Float sum = B::broadcast(0.f);
+            Float weight = B::broadcast(1.f);
+            float octaveFrequency = frequency;
+            float octaveAmplitude = amplitude;
+
+            for (int octave = 0; octave < Octaves; ++octave)
+            {
+                const Float f = B::broadcast(octaveFrequency);
+                Float signal = B::sub(B::broadcast(offset), abs<B>(source.template evaluate<B>(B::mul(x, f), B::mul(z, f), seed)));
+                signal = B::mul(B::mul(signal, signal), weight);
+                weight = clamp<B>(B::mul(signal, B::broadcast(sharpness)), 0.f, 1.f);
+                sum = B::add(sum, B::mul(signal, B::broadcast(octaveAmplitude)));
+
+                octaveFrequency *= lacunarity;
+                octaveAmplitude *= gain;
+                seed += OctaveSeedStep;
+            }
+            return sum;
+        }
+    };
+
+    // Source sampled at coordinates pushed by strength times two decorrelated warp fields
+    template<typename Warp, typename Source>
+    struct DomainWarp
+    {
+        Warp warp;
+        Source source;
+        float strength = 4.f;
+
+        template<typename B>
+        typename B::Float evaluate(typename B::Float x, typename B::Float z, std::uint32_t seed) const
+        {
+            const typename B::Float s = B::broadcast(strength);
+            const typename B::Float warpedX = B::add(x, B::mul(warp.template evaluate<B>(x, z, seed ^ WarpSeedX), s));
+            const typename B::Float warpedZ = B::add(z, B::mul(warp.template evaluate<B>(x, z, seed ^ WarpSeedZ), s));
+            return source.template evaluate<B>(warpedX, warpedZ, seed);
+        }
+    };
+
+    // low where control is under threshold, high above, blended smoothly over
+    // [threshold - falloff, threshold + falloff]. All three inputs are evaluated.
+    template<typename Control, typename Low, typename High>
+    struct Select
+    {
+        Control control;
+        Low low;
+        High high;
+        float threshold = 0.f;
+        float falloff = 0.1f;
+
+        template<typename B>
+        typename B::Float evaluate(typename B::Float x, typename B::Float z, std::uint32_t seed) const
+        {
+            using Float = typename B::Float;
+
+            const float scale = 0.5f / (falloff > 1e-6f ? falloff : 1e-6f);
+            const Float c = control.template evaluate<B>(x, z, seed);
+            const Float t = clamp<B>(B::add(B::mul(B::sub(c, B::broadcast(threshold)), B::broadcast(scale)), B::broadcast(0.5f)), 0.f, 1.f);
+            const Float smooth = B::mul(B::mul(t, t), B::sub(B::broadcast(3.f), B::add(t, t)));
+            return lerp<B>(low.template evaluate<B>(x, z, seed), high.template evaluate<B>(x, z, seed), smooth);
+        }
+    };
+
+    // Transforms, the stages after the first of a Chain:
+    //
+    //     template<typename B> typename B::Float apply(typename B::Float value) const;
+
+    struct ScaleBias
+    {
+        float scale = 1.f;
+        float bias = 0.f;
+
+        template<typename B>
+        typename B::Float apply(typename B::Float value) const
+        {
+            return B::add(B::mul(value, B::broadcast(scale)), B::broadcast(bias));
+        }
+    };
+
+    struct Clamp
+    {
+        float low = -1.f;
+        float high = 1.f;
+
+        template<typename B>
+        typename B::Float apply(typename B::Float value) const
+        {
+            return clamp<B>(value, low, high);
+        }
+    };
+
+    // The transforms of a typelist, applied front first
+    template<typename List, bool IsEmpty = is_empty_v<List>>
+    struct TransformChain
+    {
+        front_t<List> head;
+        TransformChain<pop_front_t<List>> tail;
+
+        template<typename B>
+        typename B::Float apply(typename B::Float value) const
+        {
+            return tail.template apply<B>(head.template apply<B>(value));
+        }
+    };
+
+    template<typename List>
+    struct TransformChain<List, true>
+    {
+        template<typename B>
+        typename B::Float apply(typename B::Float value) const
+        {
+            return value;
+        }
+    };
+
+    // A module followed by transforms: Chain<typelist<Module, Transform...>>. The
+    // transforms are reached through transforms.head, transforms.tail.head...
+    template<typename List>
+    struct Chain
+    {
+        front_t<List> source;
+        TransformChain<pop_front_t<List>> transforms;
+
+        template<typename B>
+        typename B::Float evaluate(typename B::Float x, typename B::Float z, std::uint32_t seed) const
+        {
+            return transforms.template apply<B>(source.template evaluate<B>(x, z, seed));
+        }
+    };
+
+    // Evaluates graph at (x0 + k * dx, z0 + k * dz) for k in [first, first + count) into
+    // out, with the same vector tail as fbmLine
+    template<typename B, typename Graph>
+    inline void evaluateLine(const Graph& graph, std::uint32_t seed, float x0, float z0, float dx, float dz, std::size_t first, std::size_t count, float* out)
+    {
+        using Float = typename B::Float;
+
+        const Float ramp = B::ramp();
+        const Float originX = B::broadcast(x0);
+        const Float originZ = B::broadcast(z0);
+        const Float stepX = B::broadcast(dx);
+        const Float stepZ = B::broadcast(dz);
+
+        auto evaluate = [&](std::size_t k)
+        {
+            const Float index = B::add(B::broadcast(static_cast<float>(first + k)), ramp);
+            return graph.template evaluate<B>(B::add(originX, B::mul(index, stepX)), B::add(originZ, B::mul(index, stepZ)), seed);
+        };
+
+        const std::size_t full = count - count % B::width;
+        for (std::size_t k = 0; k < full; k += B::width)
+            B::store(out + k, evaluate(k));
+
+        if (full < count)
+        {
+            alignas(64) float tail[B::width];
+            B::store(tail, evaluate(full));
+            for (std::size_t k = full; k < count; ++k)
+                out[k] = tail[k - full];
+        }
+    }
+
+    // Production presets
+    namespace presets {
+
+        // Rolling fBm hills
+        using Hills = Chain<typelist<Fbm<Perlin, 6>, ScaleBias>>;
+
+        inline Hills makeHills()
+        {
+            return Hills();
+        }
+
+        // Ridged mountain ranges, warped so the crests meander, rising out of fBm
+        // lowlands where a broad control noise is high
+        using Mountains = Chain<typelist<
+            Select<Fbm<Perlin, 2>, Fbm<Perlin, 6>, DomainWarp<Fbm<Perlin, 2>, RidgedMulti<Perlin, 6>>>,
+            ScaleBias>>;
+
+        inline Mountains makeMountains()
+        {
+            Mountains mountains;
+            auto& select = mountains.source;
+            select.control.frequency = 0.05f;
+            select.control.amplitude = 1.f;
+            select.threshold = 0.1f;
+            select.falloff = 0.2f;
+            select.low.amplitude = 0.25f;
+            select.high.strength = 2.f;
+            select.high.warp.frequency = 0.1f;
+            select.high.source.frequency = 0.15f;
+            select.high.source.amplitude = 0.6f;
+            mountains.transforms.head.bias = -0.3f;
+            return mountains;
+        }
+
+    }
+
+}
+
+// A composed graph behind the FractalNoise interface, for the height generators
+template<typename Graph>
+class GraphNoise
+{
+public:
+    explicit GraphNoise(const Graph& graph = Graph(), std::uint32_t seed = NoiseSettings().seed)
+        : m_graph(graph)
+        , m_seed(seed)
+    {}
+
+    const Graph& getGraph() const { return m_graph; }
+    std::uint32_t getSeed() const { return m_seed; }
+
+    float sample(float x, float z) const
+    {
+        float result;
+        noise::evaluateLine<simd::Native>(m_graph, m_seed, x, z, 0.f, 0.f, 0, 1, &result);
+        return result;
+    }
+
+    void sampleLine(float x0, float z0, float dx, float dz, std::size_t first, std::size_t count, float* out) const
+    {
+        noise::evaluateLine<simd::Native>(m_graph, m_seed, x0, z0, dx, dz, first, count, out);
+    }
+
+private:
+    Graph m_graph;
+    std::uint32_t m_seed;
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "utils/math/Math.h"
+#include "utils/math/Simd.h"
+#include "utils/memory/AlignedAllocator.h"
+
+// Points stored as three planes of coordinates (SoA): B::width consecutive points are
+// one vector load per coordinate, with no shuffles.
+template<typename T>
+struct Point3dBatch
+{
+    using Plane = std::vector<T, utils::AlignedAllocator<T, 64>>;
+
+    Point3dBatch() = default;
+
+    explicit Point3dBatch(std::size_t count)
+        : x(count)
+        , y(count)
+        , z(count)
+    {}
+
+    std::size_t size() const { return x.size(); }
+
+    void resize(std::size_t count)
+    {
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+    }
+
+    Point3d<T> get(std::size_t i) const { return Point3d<T>(x[i], y[i], z[i]); }
+
+    void set(std::size_t i, const Point3d<T>& p)
+    {
+        x[i] = p.x;
+        y[i] = p.y;
+        z[i] = p.z;
+    }
+
+    Plane x;
+    Plane y;
+    Plane z;
+};
+
+using Point3dBatchf = Point3dBatch<float>;
+
+// Operations over whole batches. Each runs backend B over the full vectors and
+// simd::Scalar over the last points, so B = simd::Scalar is the plain scalar fallback
+// the vector paths are checked against (terrain-bench). out is resized to the inputs
+// and may be one of them.
+namespace batch {
+
+    // Calls kernel(B(), i) for every whole vector of points from i = 0, then
+    // kernel(simd::Scalar(), i) for the rest
+    template<typename B, typename Kernel>
+    inline void forEach(std::size_t count, Kernel&& kernel)
+    {
+        std::size_t i = 0;
+        if constexpr (B::width > 1)
+            for (; i + B::width <= count; i += B::width)
+                kernel(B(), i);
+        for (; i < count; ++i)
+            kernel(simd::Scalar(), i);
+    }
+
+    template<typename B = simd::Native>
+    inline void add(const Point3dBatchf& a, const Point3dBatchf& b, Point3dBatchf& out)
+    {
+        out.resize(a.size());
+        forEach<B>(a.size(), [&](auto backend, std::size_t i) {
+            using V = decltype(backend);
+            V::store(out.x.data() + i, V::add(V::load(a.x.data() + i), V::load(b.x.data() + i)));
+            V::store(out.y.data() + i, V::add(V::load(a.y.data() + i), V::load(b.y.data() + i)));
+            V::store(out.z.data() + i, V::add(V::load(a.z.data() + i), V::load(b.z.data() + i)));
+        });
+    }
+
+    template<typename B = simd::Native>
+    inline void sub(const Point3dBatchf& a, const Point3dBatchf& b, Point3dBatchf& out)
+    {
+        out.resize(a.size());
+        forEach<B>(a.size(), [&](auto backend, std::size_t i) {
+            using V = decltype(backend);
+            V::store(out.x.data() + i, V::sub(V::load(a.x.data() + i), V::load(b.x.data() + i)));
+            V::store(out.y.data() + i, V::sub(V::load(a.y.data() + i), V::load(b.y.data() + i)));
+            V::store(out.z.data() + i, V::sub(V::load(a.z.data() + i), V::load(b.z.data() + i)));
+        });
+    }
+
+    template<typename B = simd::Native>
+    inline void cross(const Point3dBatchf& a, const Point3dBatchf& b, Point3dBatchf& out)
+    {
+        out.resize(a.size());
+        forEach<B>(a.size(), [&](auto backend, std::size_t i) {
+            using V = decltype(backend);
+            const auto ax = V::load(a.x.data() + i);
+            const auto ay = V::load(a.y.data() + i);
+            const auto az = V::load(a.z.data() + i);
+            const auto bx = V::load(b.x.data() + i);
+            const auto by = V::load(b.y.data() + i);
+            const auto bz = V::load(b.z.data() + i);
+            V::store(out.x.data() + i, V::sub(V::mul(ay, bz), V::mul(az, by)));
+            V::store(out.y.data() + i, V::sub(V::mul(az, bx), V::mul(ax, bz)));
+            V::store(out.z.data() + i, V::sub(V::mul(ax, by), V::mul(ay, bx)));
+        });
+    }
+
+    // Unit vectors; null vectors stay null, as with Point3d::operator/
+    template<typename B = simd::Native>
+    inline void normalize(const Point3dBatchf& a, Point3dBatchf& out)
+    {
+        out.resize(a.size());
+        forEach<B>(a.size(), [&](auto backend, std::size_t i) {
+            using V = decltype(backend);
+            const auto x = V::load(a.x.data() + i);
+            const auto y = V::load(a.y.data() + i);
+            const auto z = V::load(a.z.data() + i);
+
+            // a null vector times the finite 1 / sqrt(1e-30) is still null, no branch needed
+            const auto lengthSquared = V::add(V::add(V::mul(x, x), V::mul(y, y)), V::mul(z, z));
+            const auto inverse = V::rsqrt(V::max(lengthSquared, V::broadcast(1e-30f)));
+            V::store(out.x.data() + i, V::mul(x, inverse));
+            V::store(out.y.data() + i, V::mul(y, inverse));
+            V::store(out.z.data() + i, V::mul(z, inverse));
+        });
+    }
+
+    namespace detail {
+
+        // m applied to a, with w = 1 for points and 0 for directions
+        template<typename B, bool IsPoint>
+        inline void transform(const Mat4<float>& m, const Point3dBatchf& a, Point3dBatchf& out)
+        {
+            out.resize(a.size());
+            forEach<B>(a.size(), [&](auto backend, std::size_t i) {
+                using V = decltype(backend);
+                const auto x = V::load(a.x.data() + i);
+                const auto y = V::load(a.y.data() + i);
+                const auto z = V::load(a.z.data() + i);
+
+                auto row = [&](int line) {
+                    auto sum = V::add(V::add(V::mul(V::broadcast(m(line, 0)), x), V::mul(V::broadcast(m(line, 1)), y)), V::mul(V::broadcast(m(line, 2)), z));
+                    if constexpr (IsPoint)
+                        sum = V::add(sum, V::broadcast(m(line, 3)));
+                    return sum;
+                };
+                const auto tx = row(0);
+                const auto ty = row(1);
+                const auto tz = row(2);
+                V::store(out.x.data() + i, tx);
+                V::store(out.y.data() + i, ty);
+                V::store(out.z.data() + i, tz);
+            });
+        }
+
+    }
+
+    // Mat4::transformPoint over the batch
+    template<typename B = simd::Native>
+    inline void transformPoints(const Mat4<float>& m, const Point3dBatchf& a, Point3dBatchf& out)
+    {
+        detail::transform<B, true>(m, a, out);
+    }
+
+    // Mat4::transformDirection over the batch
+    template<typename B = simd::Native>
+    inline void transformDirections(const Mat4<float>& m, const Point3dBatchf& a, Point3dBatchf& out)
+    {
+        detail::transform<B, false>(m, a, out);
+    }
+
+}
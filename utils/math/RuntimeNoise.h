@@ -0,0 +1,650 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/math/Noise.h"
+#include "utils/math/NoiseGraph.h"
+#include "utils/math/Simd.h"
+#include "utils/memory/AlignedAllocator.h"
+#include "utils/threading/ThreadPool.h"
+
+// Noise graphs assembled at runtime, from presets written by designers. Nodes are not
+// evaluated point by point through virtual calls: each one runs over a whole block of
+// points, reading and writing contiguous SoA buffers, so its inner loop is the same
+// vector loop as the compile-time modules of NoiseGraph.h. Nodes are scheduled in
+// order once, and buffers are reused as soon as the last node reading them ran, which
+// keeps the scratch of a block in L1.
+//
+// Preset files have one statement per line, # starts a comment:
+//
+//     seed 1337
+//     control = fbm x z octaves=2 frequency=0.05 amplitude=1
+//     detail = fbm x z
+//     height = select control detail detail threshold=0.1
+//     output height
+//
+// Operations and their inputs, the parameters default like the NoiseGraph.h modules:
+//
+//     const                       value
+//     fbm [x z]                   octaves frequency amplitude lacunarity gain seed
+//     ridged [x z]                same, plus offset sharpness
+//     add a b, sub a b, mul a b, min a b, max a b, abs a
+//     scale_bias a                scale bias
+//     clamp a                     low high
+//     select control low high     threshold falloff
+//
+// x and z are the sample coordinates. The coordinates of fbm and ridged default to
+// them and may be any node, which is how domain warping is written. seed is xor-ed
+// into the graph seed, and accepts hexadecimal.
+
+namespace noise {
+
+    enum class NodeOp
+    {
+        X,
+        Z,
+        Constant,
+        Fbm,
+        Ridged,
+        Add,
+        Sub,
+        Mul,
+        Min,
+        Max,
+        Abs,
+        ScaleBias,
+        Clamp,
+        Select
+    };
+
+    struct GraphNode
+    {
+        NodeOp op = NodeOp::Constant;
+        int inputs[3] = { -1, -1, -1 };     // indices of earlier nodes
+        std::uint32_t seed = 0;
+        int octaves = 6;
+        float frequency = 0.25f;
+        float amplitude = 0.5f;
+        float lacunarity = 2.f;
+        float gain = 0.5f;
+        float offset = 1.f;
+        float sharpness = 2.f;
+        float scale = 1.f;
+        float bias = 0.f;
+        float low = -1.f;
+        float high = 1.f;
+        float threshold = 0.f;
+        float falloff = 0.1f;
+        float value = 0.f;
+    };
+
+    // RidgedMulti with the octave count known only at runtime
+    template<typename B>
+    inline typename B::Float ridged(const GraphNode& node, std::uint32_t seed, typename B::Float x, typename B::Float z)
+    {
+        using Float = typename B::Float;
+
+        Float sum = B::broadcast(0.f);
+        Float weight = B::broadcast(1.f);
+        float octaveFrequency = node.frequency;
+        float octaveAmplitude = node.amplitude;
+
+        for (int octave = 0; octave < node.octaves; ++octave)
+        {
+            const Float f = B::broadcast(octaveFrequency);
+            Float signal = B::sub(B::broadcast(node.offset), abs<B>(perlin<B>(B::mul(x, f), B::mul(z, f), B::broadcastInt(seed))));
+            signal = B::mul(B::mul(signal, signal), weight);
+            weight = clamp<B>(B::mul(signal, B::broadcast(node.sharpness)), 0.f, 1.f);
+            sum = B::add(sum, B::mul(signal, B::broadcast(octaveAmplitude)));
+
+            octaveFrequency *= node.lacunarity;
+            octaveAmplitude *= node.gain;
+            seed += OctaveSeedStep;
+        }
+        return sum;
+    }
+
+    // Coordinates of the points first..first + count of a line, as evaluateLine computes
+    // them. Writes whole vectors, up to B::width - 1 floats past count.
+    template<typename B>
+    inline void lineCoordinates(float x0, float z0, float dx, float dz, std::size_t first, std::size_t count, float* xs, float* zs)
+    {
+        using Float = typename B::Float;
+
+        const Float ramp = B::ramp();
+        const Float originX = B::broadcast(x0);
+        const Float originZ = B::broadcast(z0);
+        const Float stepX = B::broadcast(dx);
+        const Float stepZ = B::broadcast(dz);
+
+        for (std::size_t k = 0; k < count; k += B::width)
+        {
+            const Float index = B::add(B::broadcast(static_cast<float>(first + k)), ramp);
+            B::store(xs + k, B::add(originX, B::mul(index, stepX)));
+            B::store(zs + k, B::add(originZ, B::mul(index, stepZ)));
+        }
+    }
+
+    class RuntimeGraph
+    {
+    public:
+        // Points per block: the 3 to 5 buffers a preset keeps alive fit in L1
+        static constexpr std::size_t BlockSize = 512;
+
+        explicit RuntimeGraph(std::uint32_t seed = NoiseSettings().seed)
+            : m_seed(seed)
+        {}
+
+        // The per-block loops of one instruction set. makeBackend<simd::Native>() is the
+        // default; terrain::getKernels() holds the one chosen at startup.
+        struct Backend
+        {
+            const float* (*runBlock)(const RuntimeGraph& graph, float* buffers, std::size_t count);
+            void (*lineCoordinates)(float x0, float z0, float dx, float dz, std::size_t first, std::size_t count, float* xs, float* zs);
+        };
+
+        template<typename B>
+        static Backend makeBackend()
+        {
+            return Backend{ &runBlock<B>, &noise::lineCoordinates<B> };
+        }
+
+        static RuntimeGraph parse(std::istream& in);
+        static RuntimeGraph load(const std::string& path);
+
+        std::uint32_t getSeed() const { return m_seed; }
+        void setSeed(std::uint32_t seed) { m_seed = seed; }
+
+        // Appends a node reading earlier nodes and returns its index
+        int addNode(const GraphNode& node)
+        {
+            for (int input : node.inputs)
+                if (input >= static_cast<int>(m_nodes.size()))
+                    throw std::invalid_argument("noise graph: a node can only read earlier nodes");
+
+            m_nodes.push_back(node);
+            return static_cast<int>(m_nodes.size()) - 1;
+        }
+
+        // Schedules the nodes node depends on and assigns them buffers. Nodes added
+        // afterwards are not evaluated until the output is set again.
+        void setOutput(int node)
+        {
+            m_output = node;
+            compile();
+        }
+
+        bool isEmpty() const { return m_output < 0; }
+        std::size_t getNodeCount() const { return m_nodes.size(); }
+
+        // Buffers of BlockSize floats one block needs, coordinates included
+        std::size_t getBufferCount() const { return m_bufferCount; }
+
+        // Evaluates the points (x[k], z[k]), blocks in parallel
+        void evaluate(const float* x, const float* z, std::size_t count, float* out, const Backend& backend = makeBackend<simd::Native>()) const;
+
+        // The points of a line, like FractalNoise::sampleLine
+        void sampleLine(float x0, float z0, float dx, float dz, std::size_t first, std::size_t count, float* out, const Backend& backend = makeBackend<simd::Native>()) const;
+
+        // The samples [columnBegin, columnEnd) x [rowBegin, rowEnd) of a grid, row after
+        // row into out, whose rows are outStride floats apart. A block spans several rows,
+        // so narrow tiles still fill whole blocks.
+        void sampleGrid(float originX, float originZ, float spacing, int columnBegin, int columnEnd, int rowBegin, int rowEnd, float* out, std::size_t outStride, const Backend& backend = makeBackend<simd::Native>()) const;
+
+        float sample(float x, float z) const
+        {
+            float result;
+            sampleLine(x, z, 0.f, 0.f, 0, 1, &result);
+            return result;
+        }
+
+    private:
+        // Buffers 0 and 1 hold the coordinates of the block
+        static constexpr int BufferX = 0;
+        static constexpr int BufferZ = 1;
+
+        // Floats between buffers: room for the vectors lineCoordinates writes past the end
+        static constexpr std::size_t BufferStride = BlockSize + 16;
+
+        struct Step
+        {
+            int node;
+            int output;
+            int inputs[3];
+        };
+
+        using Scratch = std::vector<float, utils::AlignedAllocator<float, 64>>;
+
+        void compile();
+
+        // Scratch of the calling thread, with room for the buffers of this graph
+        float* getScratch() const
+        {
+            thread_local Scratch scratch;
+            if (scratch.size() < m_bufferCount * BufferStride)
+                scratch.resize(m_bufferCount * BufferStride, 0.f);
+            return scratch.data();
+        }
+
+        // Runs the schedule of graph over the first count points of the coordinate
+        // buffers, and returns the buffer holding the result
+        template<typename B>
+        static const float* runBlock(const RuntimeGraph& graph, float* buffers, std::size_t count);
+
+        std::uint32_t m_seed;
+        std::vector<GraphNode> m_nodes;
+        int m_output = -1;
+
+        std::vector<Step> m_schedule;
+        std::size_t m_bufferCount = 2;
+        int m_outputBuffer = BufferX;
+    };
+
+    inline void RuntimeGraph::compile()
+    {
+        if (m_output < 0 || m_output >= static_cast<int>(m_nodes.size()))
+            throw std::invalid_argument("noise graph: no output node");
+
+        // nodes the output depends on; inputs always come before their readers
+        std::vector<bool> live(m_nodes.size(), false);
+        live[m_output] = true;
+        for (int i = m_output; i >= 0; --i)
+            if (live[i])
+                for (int input : m_nodes[i].inputs)
+                    if (input >= 0)
+                        live[input] = true;
+
+        // last node reading each buffer, so that it can be handed out again after it
+        constexpr int Never = std::numeric_limits<int>::max();
+        std::vector<int> lastUse(m_nodes.size(), -1);
+        for (int i = 0; i <= m_output; ++i)
+            if (live[i])
+                for (int input : m_nodes[i].inputs)
+                    if (input >= 0)
+                        lastUse[input] = i;
+        lastUse[m_output] = Never;
+
+        std::vector<int> buffers(m_nodes.size(), -1);
+        std::vector<int> freeBuffers;
+        int bufferCount = 2;
+
+        m_schedule.clear();
+        for (int i = 0; i <= m_output; ++i)
+        {
+            if (!live[i])
+                continue;
+
+            const GraphNode& node = m_nodes[i];
+            if (node.op == NodeOp::X || node.op == NodeOp::Z)
+            {
+                buffers[i] = node.op == NodeOp::X ? BufferX : BufferZ;
+                continue;
+            }
+
+            Step step{ i, -1, { -1, -1, -1 } };
+            for (int k = 0; k < 3; ++k)
+                if (node.inputs[k] >= 0)
+                    step.inputs[k] = buffers[node.inputs[k]];
+
+            // every node reads an element before writing it, so the output may take the
+            // buffer of an input read for the last time here
+            for (int k = 0; k < 3; ++k)
+            {
+                const int input = node.inputs[k];
+                const int buffer = step.inputs[k];
+                if (input >= 0 && lastUse[input] == i && buffer != BufferX && buffer != BufferZ
+                    && std::find(freeBuffers.begin(), freeBuffers.end(), buffer) == freeBuffers.end())
+                    freeBuffers.push_back(buffer);
+            }
+
+            if (freeBuffers.empty())
+                step.output = bufferCount++;
+            else
+            {
+                step.output = freeBuffers.back();
+                freeBuffers.pop_back();
+            }
+            buffers[i] = step.output;
+
+            // a result nobody reads, only possible for the output itself
+            if (lastUse[i] < 0)
+                freeBuffers.push_back(step.output);
+
+            m_schedule.push_back(step);
+        }
+
+        m_outputBuffer = buffers[m_output];
+        m_bufferCount = static_cast<std::size_t>(bufferCount);
+    }
+
+    template<typename B>
+    inline const float* RuntimeGraph::runBlock(const RuntimeGraph& graph, float* buffers, std::size_t count)
+    {
+        using Float = typename B::Float;
+
+        auto buffer = [&](int index) { return buffers + static_cast<std::size_t>(index) * BufferStride; };
+        const std::size_t padded = (count + B::width - 1) / B::width * B::width;
+
+        for (const Step& step : graph.m_schedule)
+        {
+            const GraphNode& node = graph.m_nodes[step.node];
+            const std::uint32_t seed = graph.m_seed ^ node.seed;
+            const float* a = step.inputs[0] >= 0 ? buffer(step.inputs[0]) : buffer(BufferX);
+            const float* b = step.inputs[1] >= 0 ? buffer(step.inputs[1]) : buffer(BufferZ);
+            const float* c = step.inputs[2] >= 0 ? buffer(step.inputs[2]) : nullptr;
+            float* out = buffer(step.output);
+
+            switch (node.op)
+            {
+            case NodeOp::Constant:
+                for (std::size_t k = 0; k < padded; k += B::width)
+                    B::store(out + k, B::broadcast(node.value));
+                break;
+
+            case NodeOp::Fbm:
+            {
+                const NoiseSettings settings{ seed, node.octaves, node.frequency, node.amplitude, node.lacunarity, node.gain };
+                for (std::size_t k = 0; k < padded; k += B::width)
+                    B::store(out + k, fbm<B>(settings, B::load(a + k), B::load(b + k)));
+                break;
+            }
+
+            case NodeOp::Ridged:
+                for (std::size_t k = 0; k < padded; k += B::width)
+                    B::store(out + k, ridged<B>(node, seed, B::load(a + k), B::load(b + k)));
+                break;
+
+            case NodeOp::Add:
+                for (std::size_t k = 0; k < padded; k += B::width)
+                    B::store(out + k, B::add(B::load(a + k), B::load(b + k)));
+                break;
+
+            case NodeOp::Sub:
+                for (std::size_t k = 0; k < padded; k += B::width)
+                    B::store(out + k, B::sub(B::load(a + k), B::load(b + k)));
+                break;
+
+            case NodeOp::Mul:
+                for (std::size_t k = 0; k < padded; k += B::width)
+                    B::store(out + k, B::mul(B::load(a + k), B::load(b + k)));
+                break;
+
+            case NodeOp::Min:
+                for (std::size_t k = 0; k < padded; k += B::width)
+                    B::store(out + k, B::min(B::load(a + k), B::load(b + k)));
+                break;
+
+            case NodeOp::Max:
+                for (std::size_t k = 0; k < padded; k += B::width)
+                    B::store(out + k, B::max(B::load(a + k), B::load(b + k)));
+                break;
+
+            case NodeOp::Abs:
+                for (std::size_t k = 0; k < padded; k += B::width)
+                    B::store(out + k, abs<B>(B::load(a + k)));
+                break;
+
+            case NodeOp::ScaleBias:
+            {
+                const Float scale = B::broadcast(node.scale);
+                const Float bias = B::broadcast(node.bias);
+                for (std::size_t k = 0; k < padded; k += B::width)
+                    B::store(out + k, B::add(B::mul(B::load(a + k), scale), bias));
+                break;
+            }
+
+            case NodeOp::Clamp:
+                for (std::size_t k = 0; k < padded; k += B::width)
+                    B::store(out + k, clamp<B>(B::load(a + k), node.low, node.high));
+                break;
+
+            case NodeOp::Select:
+            {
+                // same blend as the Select module
+                const Float threshold = B::broadcast(node.threshold);
+                const Float scale = B::broadcast(0.5f / (node.falloff > 1e-6f ? node.falloff : 1e-6f));
+                for (std::size_t k = 0; k < padded; k += B::width)
+                {
+                    const Float t = clamp<B>(B::add(B::mul(B::sub(B::load(a + k), threshold), scale), B::broadcast(0.5f)), 0.f, 1.f);
+                    const Float smooth = B::mul(B::mul(t, t), B::sub(B::broadcast(3.f), B::add(t, t)));
+                    B::store(out + k, lerp<B>(B::load(b + k), B::load(c + k), smooth));
+                }
+                break;
+            }
+
+            case NodeOp::X:
+            case NodeOp::Z:
+                break;
+            }
+        }
+        return buffer(graph.m_outputBuffer);
+    }
+
+    inline void RuntimeGraph::evaluate(const float* x, const float* z, std::size_t count, float* out, const Backend& backend) const
+    {
+        if (isEmpty())
+            throw std::logic_error("noise graph: no output node");
+
+        const std::size_t blocks = (count + BlockSize - 1) / BlockSize;
+        utils::ThreadPoolInstance::GetInstance()->parallelFor(0, blocks, 1, [&](std::size_t firstBlock, std::size_t lastBlock) {
+            float* buffers = getScratch();
+            for (std::size_t block = firstBlock; block < lastBlock; ++block)
+            {
+                const std::size_t first = block * BlockSize;
+                const std::size_t blockCount = std::min(BlockSize, count - first);
+                std::copy(x + first, x + first + blockCount, buffers + BufferX * BufferStride);
+                std::copy(z + first, z + first + blockCount, buffers + BufferZ * BufferStride);
+
+                const float* result = backend.runBlock(*this, buffers, blockCount);
+                std::copy(result, result + blockCount, out + first);
+            }
+        });
+    }
+
+    inline void RuntimeGraph::sampleLine(float x0, float z0, float dx, float dz, std::size_t first, std::size_t count, float* out, const Backend& backend) const
+    {
+        if (isEmpty())
+            throw std::logic_error("noise graph: no output node");
+
+        float* buffers = getScratch();
+        for (std::size_t done = 0; done < count; done += BlockSize)
+        {
+            const std::size_t blockCount = std::min(BlockSize, count - done);
+            backend.lineCoordinates(x0, z0, dx, dz, first + done, blockCount, buffers + BufferX * BufferStride, buffers + BufferZ * BufferStride);
+
+            const float* result = backend.runBlock(*this, buffers, blockCount);
+            std::copy(result, result + blockCount, out + done);
+        }
+    }
+
+    inline void RuntimeGraph::sampleGrid(float originX, float originZ, float spacing, int columnBegin, int columnEnd, int rowBegin, int rowEnd, float* out, std::size_t outStride, const Backend& backend) const
+    {
+        if (isEmpty())
+            throw std::logic_error("noise graph: no output node");
+        if (columnEnd <= columnBegin || rowEnd <= rowBegin)
+            return;
+
+        const std::size_t width = static_cast<std::size_t>(columnEnd - columnBegin);
+        const std::size_t total = width * static_cast<std::size_t>(rowEnd - rowBegin);
+        float* buffers = getScratch();
+        float* xs = buffers + BufferX * BufferStride;
+        float* zs = buffers + BufferZ * BufferStride;
+
+        for (std::size_t blockFirst = 0; blockFirst < total; blockFirst += BlockSize)
+        {
+            const std::size_t blockCount = std::min(BlockSize, total - blockFirst);
+
+            // the row segments covered by the block, in order: each one overwrites what
+            // the previous wrote past its end
+            for (std::size_t point = blockFirst; point < blockFirst + blockCount;)
+            {
+                const std::size_t row = point / width;
+                const std::size_t column = point % width;
+                const std::size_t count = std::min(width - column, blockFirst + blockCount - point);
+                const float z = originZ + static_cast<int>(rowBegin + row) * spacing;
+                backend.lineCoordinates(originX, z, spacing, 0.f, columnBegin + column, count, xs + point - blockFirst, zs + point - blockFirst);
+                point += count;
+            }
+
+            const float* result = backend.runBlock(*this, buffers, blockCount);
+            for (std::size_t point = blockFirst; point < blockFirst + blockCount;)
+            {
+                const std::size_t row = point / width;
+                const std::size_t column = point % width;
+                const std::size_t count = std::min(width - column, blockFirst + blockCount - point);
+                std::copy(result + point - blockFirst, result + point - blockFirst + count, out + row * outStride + column);
+                point += count;
+            }
+        }
+    }
+
+    inline RuntimeGraph RuntimeGraph::parse(std::istream& in)
+    {
+        struct Operation
+        {
+            NodeOp op;
+            int inputCount;
+            bool coordinates;       // fbm and ridged: the two inputs default to x and z
+        };
+        static const std::unordered_map<std::string, Operation> operations = {
+            { "const", { NodeOp::Constant, 0, false } },
+            { "fbm", { NodeOp::Fbm, 2, true } },
+            { "ridged", { NodeOp::Ridged, 2, true } },
+            { "add", { NodeOp::Add, 2, false } },
+            { "sub", { NodeOp::Sub, 2, false } },
+            { "mul", { NodeOp::Mul, 2, false } },
+            { "min", { NodeOp::Min, 2, false } },
+            { "max", { NodeOp::Max, 2, false } },
+            { "abs", { NodeOp::Abs, 1, false } },
+            { "scale_bias", { NodeOp::ScaleBias, 1, false } },
+            { "clamp", { NodeOp::Clamp, 1, false } },
+            { "select", { NodeOp::Select, 3, false } },
+        };
+        static const std::unordered_map<std::string, float GraphNode::*> floatParameters = {
+            { "frequency", &GraphNode::frequency }, { "amplitude", &GraphNode::amplitude },
+            { "lacunarity", &GraphNode::lacunarity }, { "gain", &GraphNode::gain },
+            { "offset", &GraphNode::offset }, { "sharpness", &GraphNode::sharpness },
+            { "scale", &GraphNode::scale }, { "bias", &GraphNode::bias },
+            { "low", &GraphNode::low }, { "high", &GraphNode::high },
+            { "threshold", &GraphNode::threshold }, { "falloff", &GraphNode::falloff },
+            { "value", &GraphNode::value },
+        };
+
+        RuntimeGraph graph;
+        std::unordered_map<std::string, int> names;
+        names["x"] = graph.addNode(GraphNode{ NodeOp::X });
+        names["z"] = graph.addNode(GraphNode{ NodeOp::Z });
+
+        std::string line;
+        int lineNumber = 0;
+        auto fail = [&](const std::string& message) {
+            throw std::runtime_error("noise preset, line " + std::to_string(lineNumber) + ": " + message);
+        };
+        auto findNode = [&](const std::string& name) {
+            const auto it = names.find(name);
+            if (it == names.end())
+                fail("unknown node '" + name + "'");
+            return it->second;
+        };
+
+        while (std::getline(in, line))
+        {
+            ++lineNumber;
+            line = line.substr(0, line.find('#'));
+
+            std::istringstream tokens(line);
+            std::vector<std::string> words;
+            for (std::string word; tokens >> word;)
+                words.push_back(word);
+            if (words.empty())
+                continue;
+
+            try
+            {
+                if (words[0] == "seed" && words.size() == 2)
+                {
+                    graph.setSeed(static_cast<std::uint32_t>(std::stoul(words[1], nullptr, 0)));
+                    continue;
+                }
+                if (words[0] == "output" && words.size() == 2)
+                {
+                    graph.setOutput(findNode(words[1]));
+                    continue;
+                }
+                if (words.size() < 3 || words[1] != "=")
+                    fail("expected 'name = operation inputs... parameter=value...'");
+                if (names.count(words[0]))
+                    fail("'" + words[0] + "' is already defined");
+
+                const auto operation = operations.find(words[2]);
+                if (operation == operations.end())
+                    fail("unknown operation '" + words[2] + "'");
+
+                GraphNode node;
+                node.op = operation->second.op;
+                int inputCount = 0;
+                for (std::size_t i = 3; i < words.size(); ++i)
+                {
+                    const std::size_t equal = words[i].find('=');
+                    if (equal == std::string::npos)
+                    {
+                        if (inputCount == operation->second.inputCount)
+                            fail("too many inputs for " + words[2]);
+                        node.inputs[inputCount++] = findNode(words[i]);
+                        continue;
+                    }
+
+                    const std::string key = words[i].substr(0, equal);
+                    const std::string value = words[i].substr(equal + 1);
+                    if (key == "octaves")
+                        node.octaves = std::stoi(value);
+                    else if (key == "seed")
+                        node.seed = static_cast<std::uint32_t>(std::stoul(value, nullptr, 0));
+                    else if (const auto parameter = floatParameters.find(key); parameter != floatParameters.end())
+                        node.*(parameter->second) = std::stof(value);
+                    else
+                        fail("unknown parameter '" + key + "'");
+                }
+
+                if (inputCount == 0 && operation->second.coordinates)
+                {
+                    node.inputs[0] = names["x"];
+                    node.inputs[1] = names["z"];
+                    inputCount = 2;
+                }
+                if (inputCount != operation->second.inputCount)
+                    fail(words[2] + " takes " + std::to_string(operation->second.inputCount) + " inputs");
+
+                names[words[0]] = graph.addNode(node);
+            }
+            catch (const std::logic_error&)
+            {
+                // std::stoi and friends
+                fail("invalid number");
+            }
+        }
+
+        if (graph.isEmpty())
+            fail("no output");
+        return graph;
+    }
+
+    inline RuntimeGraph RuntimeGraph::load(const std::string& path)
+    {
+        std::ifstream file(path);
+        if (!file)
+            throw std::runtime_error("noise preset " + path + " can't be opened");
+        return parse(file);
+    }
+
+}
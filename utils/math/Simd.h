@@ -0,0 +1,238 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TERRAIN_SIMD_SSE2 1
+#include <emmintrin.h>
+#if defined(__SSE4_1__) || defined(__AVX__)
+#include <smmintrin.h>
+#endif
+#endif
+
+#if defined(__AVX2__)
+#define TERRAIN_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX512F__)
+#define TERRAIN_SIMD_AVX512 1
+#endif
+
+// Thin wrappers over the vector instruction sets used by the hot terrain kernels.
+// A kernel is written once as a template over a backend and instantiated for the
+// widest backend the compiler targets (see simd::Native). The hottest ones are also
+// instantiated once per instruction set and picked at startup (engine/terrain/Kernels.h).
+//
+// A backend only exists in the translation units compiled for its instruction set.
+namespace simd {
+
+    struct Scalar
+    {
+        using Float = float;
+        using Int = std::uint32_t;
+        static constexpr int width = 1;
+        static constexpr const char* name = "scalar";
+
+        static Float broadcast(float v) { return v; }
+        static Int broadcastInt(std::uint32_t v) { return v; }
+        static Float ramp() { return 0.f; }
+
+        static Float load(const float* p) { return *p; }
+        static void store(float* p, Float v) { *p = v; }
+
+        static Float add(Float a, Float b) { return a + b; }
+        static Float sub(Float a, Float b) { return a - b; }
+        static Float mul(Float a, Float b) { return a * b; }
+        static Float min(Float a, Float b) { return a < b ? a : b; }
+        static Float max(Float a, Float b) { return a > b ? a : b; }
+        static Float floor(Float a) { return std::floor(a); }
+        static Float rsqrt(Float a) { return 1.f / std::sqrt(a); }
+
+        static Int add(Int a, Int b) { return a + b; }
+        static Int mul(Int a, Int b) { return a * b; }
+        static Int bitAnd(Int a, Int b) { return a & b; }
+        static Int bitXor(Int a, Int b) { return a ^ b; }
+        template<int n> static Int shiftLeft(Int a) { return a << n; }
+        template<int n> static Int shiftRight(Int a) { return a >> n; }
+
+        static Int toInt(Float a) { return static_cast<Int>(static_cast<std::int32_t>(a)); }
+        static Float toFloat(Int a) { return static_cast<float>(static_cast<std::int32_t>(a)); }
+
+        // xor the sign bit of a with the top bit of mask
+        static Float flipSign(Float a, Int mask)
+        {
+            Int bits;
+            std::memcpy(&bits, &a, sizeof(bits));
+            bits ^= mask;
+            std::memcpy(&a, &bits, sizeof(a));
+            return a;
+        }
+    };
+
+#if defined(TERRAIN_SIMD_SSE2)
+    struct Sse2
+    {
+        using Float = __m128;
+        using Int = __m128i;
+        static constexpr int width = 4;
+        static constexpr const char* name = "sse2";
+
+        static Float broadcast(float v) { return _mm_set1_ps(v); }
+        static Int broadcastInt(std::uint32_t v) { return _mm_set1_epi32(static_cast<int>(v)); }
+        static Float ramp() { return _mm_set_ps(3.f, 2.f, 1.f, 0.f); }
+
+        static Float load(const float* p) { return _mm_loadu_ps(p); }
+        static void store(float* p, Float v) { _mm_storeu_ps(p, v); }
+
+        static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+        static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+        static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+        static Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+        static Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+
+        static Float floor(Float a)
+        {
+#if defined(__SSE4_1__) || defined(__AVX__)
+            return _mm_floor_ps(a);
+#else
+            // truncate then step down where truncation rounded up (negative inputs)
+            const Float t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+            return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.f)));
+#endif
+        }
+
+        // hardware estimate refined by one Newton-Raphson step
+        static Float rsqrt(Float a)
+        {
+            const Float r = _mm_rsqrt_ps(a);
+            const Float halfA = _mm_mul_ps(a, _mm_set1_ps(0.5f));
+            return _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(halfA, _mm_mul_ps(r, r))));
+        }
+
+        static Int add(Int a, Int b) { return _mm_add_epi32(a, b); }
+
+        static Int mul(Int a, Int b)
+        {
+#if defined(__SSE4_1__) || defined(__AVX__)
+            return _mm_mullo_epi32(a, b);
+#else
+            const Int even = _mm_mul_epu32(a, b);
+            const Int odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+            return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+        }
+
+        static Int bitAnd(Int a, Int b) { return _mm_and_si128(a, b); }
+        static Int bitXor(Int a, Int b) { return _mm_xor_si128(a, b); }
+        template<int n> static Int shiftLeft(Int a) { return _mm_slli_epi32(a, n); }
+        template<int n> static Int shiftRight(Int a) { return _mm_srli_epi32(a, n); }
+
+        static Int toInt(Float a) { return _mm_cvttps_epi32(a); }
+        static Float toFloat(Int a) { return _mm_cvtepi32_ps(a); }
+
+        static Float flipSign(Float a, Int mask) { return _mm_xor_ps(a, _mm_castsi128_ps(mask)); }
+    };
+#endif
+
+#if defined(TERRAIN_SIMD_AVX2)
+    struct Avx2
+    {
+        using Float = __m256;
+        using Int = __m256i;
+        static constexpr int width = 8;
+        static constexpr const char* name = "avx2";
+
+        static Float broadcast(float v) { return _mm256_set1_ps(v); }
+        static Int broadcastInt(std::uint32_t v) { return _mm256_set1_epi32(static_cast<int>(v)); }
+        static Float ramp() { return _mm256_set_ps(7.f, 6.f, 5.f, 4.f, 3.f, 2.f, 1.f, 0.f); }
+
+        static Float load(const float* p) { return _mm256_loadu_ps(p); }
+        static void store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+
+        static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+        static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+        static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+        static Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+        static Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+        static Float floor(Float a) { return _mm256_floor_ps(a); }
+
+        static Float rsqrt(Float a)
+        {
+            const Float r = _mm256_rsqrt_ps(a);
+            const Float halfA = _mm256_mul_ps(a, _mm256_set1_ps(0.5f));
+            return _mm256_mul_ps(r, _mm256_sub_ps(_mm256_set1_ps(1.5f), _mm256_mul_ps(halfA, _mm256_mul_ps(r, r))));
+        }
+
+        static Int add(Int a, Int b) { return _mm256_add_epi32(a, b); }
+        static Int mul(Int a, Int b) { return _mm256_mullo_epi32(a, b); }
+        static Int bitAnd(Int a, Int b) { return _mm256_and_si256(a, b); }
+        static Int bitXor(Int a, Int b) { return _mm256_xor_si256(a, b); }
+        template<int n> static Int shiftLeft(Int a) { return _mm256_slli_epi32(a, n); }
+        template<int n> static Int shiftRight(Int a) { return _mm256_srli_epi32(a, n); }
+
+        static Int toInt(Float a) { return _mm256_cvttps_epi32(a); }
+        static Float toFloat(Int a) { return _mm256_cvtepi32_ps(a); }
+
+        static Float flipSign(Float a, Int mask) { return _mm256_xor_ps(a, _mm256_castsi256_ps(mask)); }
+    };
+#endif
+
+#if defined(TERRAIN_SIMD_AVX512)
+    struct Avx512
+    {
+        using Float = __m512;
+        using Int = __m512i;
+        static constexpr int width = 16;
+        static constexpr const char* name = "avx512";
+
+        static Float broadcast(float v) { return _mm512_set1_ps(v); }
+        static Int broadcastInt(std::uint32_t v) { return _mm512_set1_epi32(static_cast<int>(v)); }
+        static Float ramp() { return _mm512_set_ps(15.f, 14.f, 13.f, 12.f, 11.f, 10.f, 9.f, 8.f, 7.f, 6.f, 5.f, 4.f, 3.f, 2.f, 1.f, 0.f); }
+
+        static Float load(const float* p) { return _mm512_loadu_ps(p); }
+        static void store(float* p, Float v) { _mm512_storeu_ps(p, v); }
+
+        static Float add(Float a, Float b) { return _mm512_add_ps(a, b); }
+        static Float sub(Float a, Float b) { return _mm512_sub_ps(a, b); }
+        static Float mul(Float a, Float b) { return _mm512_mul_ps(a, b); }
+        static Float min(Float a, Float b) { return _mm512_min_ps(a, b); }
+        static Float max(Float a, Float b) { return _mm512_max_ps(a, b); }
+        static Float floor(Float a) { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+
+        // 14-bit estimate refined by one Newton-Raphson step
+        static Float rsqrt(Float a)
+        {
+            const Float r = _mm512_rsqrt14_ps(a);
+            const Float halfA = _mm512_mul_ps(a, _mm512_set1_ps(0.5f));
+            return _mm512_mul_ps(r, _mm512_sub_ps(_mm512_set1_ps(1.5f), _mm512_mul_ps(halfA, _mm512_mul_ps(r, r))));
+        }
+
+        static Int add(Int a, Int b) { return _mm512_add_epi32(a, b); }
+        static Int mul(Int a, Int b) { return _mm512_mullo_epi32(a, b); }
+        static Int bitAnd(Int a, Int b) { return _mm512_and_si512(a, b); }
+        static Int bitXor(Int a, Int b) { return _mm512_xor_si512(a, b); }
+        template<int n> static Int shiftLeft(Int a) { return _mm512_slli_epi32(a, n); }
+        template<int n> static Int shiftRight(Int a) { return _mm512_srli_epi32(a, n); }
+
+        static Int toInt(Float a) { return _mm512_cvttps_epi32(a); }
+        static Float toFloat(Int a) { return _mm512_cvtepi32_ps(a); }
+
+        // _mm512_xor_ps needs AVX512DQ, the integer xor only AVX512F
+        static Float flipSign(Float a, Int mask) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), mask)); }
+    };
+#endif
+
+#if defined(TERRAIN_SIMD_AVX512)
+    using Native = Avx512;
+#elif defined(TERRAIN_SIMD_AVX2)
+    using Native = Avx2;
+#elif defined(TERRAIN_SIMD_SSE2)
+    using Native = Sse2;
+#else
+    using Native = Scalar;
+#endif
+
+}
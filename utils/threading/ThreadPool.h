@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "utils/design_patterns/Singleton.h"
+
+namespace utils {
+
+    // Work-stealing thread pool. Every worker owns a deque: it pops its own tasks
+    // from the back and steals from the front of the other deques when it runs dry.
+    // A thread waiting on parallelFor runs pending tasks instead of blocking, so the
+    // caller counts as one more worker.
+    class ThreadPool
+    {
+    public:
+        using Task = std::function<void()>;
+
+        explicit ThreadPool(std::size_t workerCount = defaultWorkerCount())
+        {
+            start(workerCount);
+        }
+
+        ~ThreadPool()
+        {
+            stop();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        static std::size_t defaultWorkerCount()
+        {
+            const unsigned hardwareThreads = std::thread::hardware_concurrency();
+            return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+        }
+
+        // Replaces the workers with workerCount new ones. The pool must be idle: no task
+        // queued or running, and no other thread using it.
+        void setWorkerCount(std::size_t workerCount)
+        {
+            stop();
+            start(workerCount);
+        }
+
+        // Number of threads that run tasks during a parallelFor: the workers plus the caller
+        std::size_t getConcurrency() const
+        {
+            return m_workers.size() + 1;
+        }
+
+        // Queues a task; runs it inline when the pool has no worker
+        void submit(Task task)
+        {
+            if (m_queues.empty())
+            {
+                task();
+                return;
+            }
+
+            const std::size_t index = (t_pool == this)
+                ? t_workerIndex
+                : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+            {
+                std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+                m_queues[index]->tasks.push_back(std::move(task));
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_sleepMutex);
+                m_pending.fetch_add(1, std::memory_order_relaxed);
+            }
+            m_wakeUp.notify_one();
+        }
+
+        // Calls body(first, last) over [begin, end) split in ranges of grain items and
+        // returns once every range is done. Ranges are fixed by grain alone, never by
+        // the thread count.
+        template<typename Body>
+        void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, Body&& body)
+        {
+            if (begin >= end)
+                return;
+
+            grain = std::max<std::size_t>(grain, 1);
+            const std::size_t rangeCount = (end - begin + grain - 1) / grain;
+
+            if (rangeCount == 1 || m_queues.empty())
+            {
+                for (std::size_t first = begin; first < end; first += grain)
+                    body(first, std::min(first + grain, end));
+                return;
+            }
+
+            std::atomic<std::size_t> remaining(rangeCount);
+            for (std::size_t first = begin; first < end; first += grain)
+            {
+                const std::size_t last = std::min(first + grain, end);
+                submit([&body, &remaining, first, last]
+                    {
+                        body(first, last);
+                        remaining.fetch_sub(1, std::memory_order_acq_rel);
+                    });
+            }
+
+            while (remaining.load(std::memory_order_acquire) != 0)
+            {
+                if (!runPendingTask())
+                    std::this_thread::yield();
+            }
+        }
+
+        // Runs one queued task on the calling thread, if any. Returns false when every queue is empty.
+        bool runPendingTask()
+        {
+            if (m_queues.empty())
+                return false;
+
+            const std::size_t home = (t_pool == this) ? t_workerIndex : 0;
+            Task task;
+
+            for (std::size_t offset = 0; offset < m_queues.size(); ++offset)
+            {
+                Queue& queue = *m_queues[(home + offset) % m_queues.size()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.tasks.empty())
+                    continue;
+
+                // the owner works LIFO for locality, thieves take the oldest task
+                if (offset == 0 && t_pool == this)
+                {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                }
+                else
+                {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+                break;
+            }
+
+            if (!task)
+                return false;
+
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+            task();
+            return true;
+        }
+
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        void start(std::size_t workerCount)
+        {
+            m_stopping = false;
+
+            m_queues.reserve(workerCount);
+            for (std::size_t i = 0; i < workerCount; ++i)
+                m_queues.push_back(std::make_unique<Queue>());
+
+            m_workers.reserve(workerCount);
+            for (std::size_t i = 0; i < workerCount; ++i)
+                m_workers.emplace_back([this, i] { workerLoop(i); });
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_sleepMutex);
+                m_stopping = true;
+            }
+            m_wakeUp.notify_all();
+
+            for (std::thread& worker : m_workers)
+                worker.join();
+
+            m_workers.clear();
+            m_queues.clear();
+        }
+
+        void workerLoop(std::size_t index)
+        {
+            t_pool = this;
+            t_workerIndex = index;
+
+            while (true)
+            {
+                if (runPendingTask())
+                    continue;
+
+                std::unique_lock<std::mutex> lock(m_sleepMutex);
+                m_wakeUp.wait(lock, [this] { return m_stopping || m_pending.load(std::memory_order_relaxed) > 0; });
+                if (m_stopping)
+                    return;
+            }
+        }
+
+        std::vector<std::unique_ptr<Queue>> m_queues;
+        std::vector<std::thread> m_workers;
+        std::atomic<std::size_t> m_nextQueue = 0;
+        std::atomic<std::size_t> m_pending = 0;
+
+        std::mutex m_sleepMutex;
+        std::condition_variable m_wakeUp;
+        bool m_stopping = false;
+
+        static inline thread_local ThreadPool* t_pool = nullptr;
+        static inline thread_local std::size_t t_workerIndex = 0;
+    };
+
+    using ThreadPoolInstance = Singleton<ThreadPool>;
+
+}